@@ -0,0 +1,184 @@
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "metrics.hpp"
+#include "result_cache.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+namespace fs = std::filesystem;
+
+const vector<string> IMAGE_EXTENSIONS = {".jpg", ".jpeg", ".png", ".bmp", ".webp", ".tif", ".tiff"};
+
+bool isImageFile(const string& path) {
+    string ext = fs::path(path).extension().string();
+    transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return find(IMAGE_EXTENSIONS.begin(), IMAGE_EXTENSIONS.end(), ext) != IMAGE_EXTENSIONS.end();
+}
+
+// Everything that changes what a cached result would be: models, preprocessing,
+// detector and quality gate settings. Model files are named with their size and
+// modification time so a retrained net at the same path invalidates the cache.
+static string cacheSignature(const BatchOptions& options) {
+    auto file = [](const string& path) {
+        error_code ec;
+        ostringstream out;
+        out << path;
+        if (path.empty()) return out.str();
+        uintmax_t size = fs::file_size(path, ec);
+        if (!ec) out << ":" << size;
+        auto time = fs::last_write_time(path, ec);
+        if (!ec) out << "@" << time.time_since_epoch().count();
+        return out.str();
+    };
+    const GenderModel& g = options.genderModel;
+    const FaceDetectorOptions& d = options.detectorOptions;
+    const QualityOptions& q = options.quality;
+    ostringstream out;
+    out << "gender " << file(g.model) << " " << file(g.config) << " " << g.inputSize.width << "x" << g.inputSize.height
+        << " mean " << g.mean[0] << "," << g.mean[1] << "," << g.mean[2] << " scale " << g.scale << " swapRB "
+        << g.swapRB << " labels";
+    for (const string& label : g.labels) out << " " << label;
+    out << "; detector " << options.detector << " " << file(d.model) << " " << file(d.config) << " conf "
+        << d.confThreshold << " width " << d.detectWidth << " haar " << d.scaleFactor << "," << d.minNeighbors << ","
+        << d.minFaceSize << "," << d.tiles;
+    out << "; quality " << q.enabled;
+    if (q.enabled)
+        out << " " << q.minSize << "," << q.minSharpness << "," << q.minBrightness << "," << q.maxBrightness << ","
+            << q.measureSize;
+    return out.str();
+}
+
+int runBatch(const BatchOptions& options) {
+    if (!fs::is_directory(options.inputDir)) {
+        cerr << "Not a directory: " << options.inputDir << endl;
+        return -1;
+    }
+    ResultWriter writer;
+    if (!writer.open(options.outputPath, options.format)) return -1;
+
+    int workers = options.workers > 0 ? options.workers : (int)max(1u, thread::hardware_concurrency());
+    // Parallelism comes from the workers; keep OpenCV from oversubscribing the cores
+    if (workers > 1) setNumThreads(1);
+
+    // cv::dnn::Net and CascadeClassifier are not thread-safe: one of each per worker
+    vector<unique_ptr<FaceDetector>> detectors;
+    vector<Net> nets;
+    for (int w = 0; w < workers; w++) {
+        detectors.push_back(createFaceDetector(options.detector, options.detectorOptions));
+        if (!detectors.back()) return -1;
+        nets.push_back(loadGenderNet(options.backend, options.genderModel));
+    }
+    warmUpGenderNets(nets, options.genderModel, options.maxBatch, options.warmup, options.warmupEverySize);
+
+    unique_ptr<ResultCache> cache;
+    if (!options.cachePath.empty()) {
+        cache = make_unique<ResultCache>();
+        if (!cache->open(options.cachePath, cacheSignature(options), options.cacheDistance)) return -1;
+    }
+
+    BoundedQueue<string> paths((size_t)workers * 4, BackpressurePolicy::Block);
+    atomic<size_t> images{0}, faces{0}, failed{0};
+    TickMeter total;
+    total.start();
+
+    vector<thread> threads;
+    for (int w = 0; w < workers; w++) {
+        threads.emplace_back([&, w] {
+            GenderBlob blob(options.maxBatch, options.genderModel);
+            CropQualityGate quality(options.quality);
+            vector<int> accepted;
+            vector<Rect> acceptedFaces;
+            vector<GenderResult> acceptedGenders;
+            vector<uint64_t> cropHashes;
+            string path;
+            while (paths.pop(path)) {
+                TickMeter timer;
+                timer.start();
+                FrameResult result;
+                result.source = path;
+                result.timestampMs = wallClockMs();
+
+                Mat image = imread(path, IMREAD_COLOR);
+                result.ok = !image.empty();
+                if (result.ok) {
+                    uint64_t imageHash = cache ? perceptualHash(image) : 0;
+                    if (!cache || !cache->findImage(imageHash, image.size(), result.faces, result.genders)) {
+                        {
+                            ScopedTimer detectTimer(Stage::Detect);
+                            detectors[w]->detect(image, result.faces);
+                        }
+                        accepted.resize(result.faces.size());
+                        for (size_t i = 0; i < accepted.size(); i++) accepted[i] = (int)i;
+                        quality.filter(image, result.faces, accepted);
+                        // Crops seen before take their cached gender and skip the net
+                        result.genders.assign(result.faces.size(), GenderResult());
+                        if (cache) {
+                            cropHashes.assign(result.faces.size(), 0);
+                            size_t kept = 0;
+                            for (int i : accepted) {
+                                if (result.faces[i].area() > 0) cropHashes[i] = perceptualHash(image(result.faces[i]));
+                                if (result.faces[i].area() == 0 || !cache->findFace(cropHashes[i], result.genders[i]))
+                                    accepted[kept++] = i;
+                            }
+                            accepted.resize(kept);
+                        }
+                        if (accepted.size() == result.faces.size()) {
+                            classifyGenderBatch(nets[w], image, result.faces, blob, result.genders);
+                        } else if (!accepted.empty()) {
+                            // Skipped crops are reported with an unknown gender
+                            acceptedFaces.clear();
+                            for (int i : accepted) acceptedFaces.push_back(result.faces[i]);
+                            classifyGenderBatch(nets[w], image, acceptedFaces, blob, acceptedGenders);
+                            for (size_t k = 0; k < accepted.size(); k++) result.genders[accepted[k]] = acceptedGenders[k];
+                        }
+                        if (cache) {
+                            for (int i : accepted)
+                                if (result.faces[i].area() > 0) cache->storeFace(cropHashes[i], result.genders[i]);
+                            cache->storeImage(imageHash, image.size(), result.faces, result.genders);
+                        }
+                    }
+                    faces += result.faces.size();
+                    metrics().faces += result.faces.size();
+                } else {
+                    failed++;
+                }
+                timer.stop();
+                result.millis = timer.getTimeMilli();
+                metrics().stage(Stage::Frame).record(result.millis);
+                metrics().frames++;
+                images++;
+                writer.write(std::move(result));
+            }
+        });
+    }
+
+    error_code ec;
+    for (auto it = fs::recursive_directory_iterator(options.inputDir, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (it->is_regular_file(ec) && isImageFile(it->path().string()))
+            paths.push(it->path().string());
+    }
+    paths.close();
+    for (auto& t : threads) t.join();
+    writer.close();
+    if (cache) cache->close();
+
+    total.stop();
+    cout << "Processed " << images << " images (" << faces << " faces, " << failed
+         << " unreadable) in " << total.getTimeSec() << " s with " << workers << " workers" << endl;
+    if (cache)
+        cout << "Result cache: " << cache->imageHits() << " image hits, " << cache->faceHits() << " face hits, "
+             << cache->images() << " images stored" << endl;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "detector.hpp"
+#include "gender.hpp"
+#include "quality.hpp"
+#include "results.hpp"
+
+struct BatchOptions {
+    // Directory walked recursively for images
+    std::string inputDir;
+    // Results file and its format
+    std::string outputPath = "results.jsonl";
+    ResultFormat format = ResultFormat::Jsonl;
+    // Worker threads, each with its own detector and gender net (0 = one per core)
+    int workers = 0;
+    int maxBatch = DEFAULT_MAX_BATCH;
+    std::string detector = "haar";
+    FaceDetectorOptions detectorOptions;
+    std::string backend = "cpu";
+    GenderModel genderModel;
+    QualityOptions quality;
+    // Warm-up passes per batch size for each worker's net (0 = none)
+    int warmup = 1;
+    // Warm every batch size up to maxBatch rather than 1 and maxBatch (OpenCL)
+    bool warmupEverySize = false;
+    // Perceptual-hash result cache file, reused across runs (empty = off), and
+    // the Hamming distance within which image hashes match (at most 3)
+    std::string cachePath;
+    int cacheDistance = 2;
+};
+
+// File extensions treated as images
+bool isImageFile(const std::string& path);
+
+// Headless run over every image under options.inputDir; returns the process exit code
+int runBatch(const BatchOptions& options);
@@ -0,0 +1,111 @@
+#include "batcher.hpp"
+#include "metrics.hpp"
+
+#include <chrono>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+GenderBatcher::GenderBatcher(const BatcherOptions& options)
+    : options_(options), queue_(options.queueDepth, BackpressurePolicy::Block) {
+    if (options_.maxBatch <= 0) options_.maxBatch = DEFAULT_MAX_BATCH;
+    int workers = max(1, options_.workers);
+    for (int i = 0; i < workers; i++) nets_.push_back(loadGenderNet(options_.backend, options_.model));
+    warmUpGenderNets(nets_, options_.model, options_.maxBatch, options_.warmup, options_.warmupEverySize);
+    for (int i = 0; i < workers; i++) threads_.emplace_back(&GenderBatcher::worker, this, i);
+}
+
+GenderBatcher::~GenderBatcher() {
+    stop();
+}
+
+future<vector<GenderResult>> GenderBatcher::submit(const Mat& frame, const vector<Rect>& faces) {
+    auto request = make_unique<Request>();
+    request->frame = frame;
+    request->faces = faces;
+    future<vector<GenderResult>> result = request->promise.get_future();
+    if (faces.empty()) {
+        request->promise.set_value({});
+    } else if (queue_.push(std::move(request))) {
+        raiseHighWater(metrics().batcherQueueHigh, queue_.size());
+    } else {
+        // Only after stop(): answer with unknown genders rather than leave the caller hanging
+        request = make_unique<Request>();
+        result = request->promise.get_future();
+        request->promise.set_value(vector<GenderResult>(faces.size()));
+    }
+    return result;
+}
+
+void GenderBatcher::stop() {
+    queue_.close();
+    for (auto& t : threads_)
+        if (t.joinable()) t.join();
+    threads_.clear();
+}
+
+void GenderBatcher::worker(int index) {
+    Net& net = nets_[index];
+    GenderBlob blob(options_.maxBatch, options_.model);
+    vector<unique_ptr<Request>> batch;
+    unique_ptr<Request> request;
+    const int64_t waitTicks = (int64_t)(options_.maxWaitMs * getTickFrequency() / 1000.0);
+
+    while (queue_.pop(request)) {
+        batch.clear();
+        size_t faces = request->faces.size();
+        batch.push_back(std::move(request));
+
+        // Gather more frames until the batch is full or the deadline passes
+        int64_t deadline = getTickCount() + waitTicks;
+        while (faces < (size_t)options_.maxBatch) {
+            if (queue_.tryPop(request)) {
+                faces += request->faces.size();
+                batch.push_back(std::move(request));
+                continue;
+            }
+            if (getTickCount() >= deadline || queue_.closed()) break;
+            this_thread::sleep_for(chrono::microseconds(50));
+        }
+        run(net, blob, batch);
+    }
+}
+
+void GenderBatcher::run(Net& net, GenderBlob& blob, vector<unique_ptr<Request>>& batch) {
+    vector<vector<GenderResult>> results(batch.size());
+    vector<GenderResult> slotResults;
+    // Request owning each filled slot of the blob
+    vector<size_t> owners;
+
+    auto flush = [&] {
+        if (owners.empty()) return;
+        slotResults.clear();
+        classifyGenderBlob(net, blob, (int)owners.size(), slotResults);
+        for (size_t k = 0; k < owners.size(); k++) results[owners[k]].push_back(slotResults[k]);
+        owners.clear();
+    };
+
+    try {
+        for (size_t r = 0; r < batch.size(); r++) {
+            for (const Rect& face : batch[r]->faces) {
+                {
+                    ScopedTimer timer(Stage::Crop);
+                    blob.setFace((int)owners.size(), batch[r]->frame, face);
+                }
+                owners.push_back(r);
+                if ((int)owners.size() == blob.capacity()) flush();
+            }
+        }
+        flush();
+        for (size_t r = 0; r < batch.size(); r++) batch[r]->promise.set_value(std::move(results[r]));
+    } catch (...) {
+        for (auto& request : batch) {
+            try {
+                request->promise.set_exception(current_exception());
+            } catch (const future_error&) {
+                // already answered
+            }
+        }
+    }
+}
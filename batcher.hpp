@@ -0,0 +1,59 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "gender.hpp"
+
+struct BatcherOptions {
+    int maxBatch = DEFAULT_MAX_BATCH;
+    // How long a worker waits for more faces before running a partial batch
+    double maxWaitMs = 2.0;
+    // Gender net instances, each on its own thread
+    int workers = 1;
+    std::string backend = "cpu";
+    GenderModel model;
+    // Warm-up passes per batch size for each net (0 = none)
+    int warmup = 1;
+    // Warm every batch size up to maxBatch rather than 1 and maxBatch (OpenCL)
+    bool warmupEverySize = false;
+    // Frames waiting for a worker
+    size_t queueDepth = 256;
+};
+
+// Pool of gender nets shared by many producers (streams, requests). Faces
+// submitted concurrently are coalesced into one batch per forward pass.
+class GenderBatcher {
+public:
+    explicit GenderBatcher(const BatcherOptions& options);
+    ~GenderBatcher();
+
+    GenderBatcher(const GenderBatcher&) = delete;
+    GenderBatcher& operator=(const GenderBatcher&) = delete;
+
+    // Queue the faces of one frame; resolves with one result per face, in order
+    std::future<std::vector<GenderResult>> submit(const cv::Mat& frame, const std::vector<cv::Rect>& faces);
+    // Finish queued work and stop the workers
+    void stop();
+
+private:
+    struct Request {
+        cv::Mat frame;
+        std::vector<cv::Rect> faces;
+        std::promise<std::vector<GenderResult>> promise;
+    };
+
+    void worker(int index);
+    void run(cv::dnn::Net& net, GenderBlob& blob, std::vector<std::unique_ptr<Request>>& batch);
+
+    BatcherOptions options_;
+    std::vector<cv::dnn::Net> nets_;
+    BoundedQueue<std::unique_ptr<Request>> queue_;
+    std::vector<std::thread> threads_;
+};
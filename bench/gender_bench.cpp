@@ -0,0 +1,260 @@
+// Benchmarks for face detection and gender classification.
+//
+//   GenderBench [--backend=cpu] [--corpus=dir] [--model=file [--config=file]] [benchmark flags]
+//
+// Frames are synthetic and seeded, or every image in --corpus resized to each
+// resolution, so runs are comparable across builds. Each benchmark reports
+// per-iteration p50/p95/p99 latency and heap allocations per iteration.
+
+#include <benchmark/benchmark.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch.hpp"
+#include "detector.hpp"
+#include "gender.hpp"
+#include "metrics.hpp"
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+// Count every heap allocation, including OpenCV's fastMalloc, by interposing
+// glibc's allocator. Elsewhere only operator new is counted.
+static atomic<size_t> g_allocations{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+
+void* malloc(size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    return __libc_malloc(n);
+}
+void* calloc(size_t n, size_t size) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void* realloc(void* p, size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+void* memalign(size_t alignment, size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    return __libc_memalign(alignment, n);
+}
+void* aligned_alloc(size_t alignment, size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    return __libc_memalign(alignment, n);
+}
+int posix_memalign(void** p, size_t alignment, size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    *p = __libc_memalign(alignment, n);
+    return *p ? 0 : 12;  // ENOMEM
+}
+}
+#else
+void* operator new(size_t n) {
+    g_allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+static string g_backend = "cpu";
+static string g_corpus;
+static GenderModel g_model;
+
+const vector<Size> RESOLUTIONS = {{640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+const int CORPUS_FRAMES = 8;
+
+// Fixed frames at one resolution: the corpus resized, or seeded noise
+static const vector<Mat>& frames(int resolution) {
+    static map<int, vector<Mat>> cache;
+    vector<Mat>& out = cache[resolution];
+    if (!out.empty()) return out;
+
+    Size size = RESOLUTIONS[resolution];
+    if (!g_corpus.empty()) {
+        for (const auto& entry : filesystem::directory_iterator(g_corpus)) {
+            if (!isImageFile(entry.path().string())) continue;
+            Mat image = imread(entry.path().string(), IMREAD_COLOR);
+            if (image.empty()) continue;
+            Mat frame;
+            resize(image, frame, size, 0, 0, INTER_AREA);
+            out.push_back(frame);
+        }
+    }
+    RNG rng(42);
+    while (out.size() < (size_t)CORPUS_FRAMES) {
+        Mat frame(size, CV_8UC3);
+        rng.fill(frame, RNG::UNIFORM, 0, 256);
+        GaussianBlur(frame, frame, Size(9, 9), 3);
+        out.push_back(frame);
+    }
+    return out;
+}
+
+// n face boxes laid out on a grid over a 1280x720 frame
+static vector<Rect> faceGrid(int n) {
+    vector<Rect> faces;
+    int cols = 8;
+    for (int i = 0; i < n; i++)
+        faces.emplace_back(20 + (i % cols) * 150, 20 + (i / cols) * 170, 120, 140);
+    return faces;
+}
+
+static Net& genderNet() {
+    static Net net = loadGenderNet(g_backend, g_model);
+    return net;
+}
+
+// Per-iteration latency and allocations of a benchmark loop
+class IterationStats {
+public:
+    explicit IterationStats(benchmark::State& state) : state_(state) {}
+    void begin() {
+        allocations_ = g_allocations.load(memory_order_relaxed);
+        start_ = getTickCount();
+    }
+    void end() {
+        histogram_.record((getTickCount() - start_) * 1000.0 / getTickFrequency());
+        allocSum_ += g_allocations.load(memory_order_relaxed) - allocations_;
+    }
+    ~IterationStats() {
+        LatencyHistogram::Snapshot s = histogram_.snapshot();
+        state_.counters["p50_ms"] = s.percentile(0.50);
+        state_.counters["p95_ms"] = s.percentile(0.95);
+        state_.counters["p99_ms"] = s.percentile(0.99);
+        state_.counters["allocs"] = benchmark::Counter((double)allocSum_, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state_;
+    LatencyHistogram histogram_;
+    int64_t start_ = 0;
+    size_t allocations_ = 0;
+    size_t allocSum_ = 0;
+};
+
+// Args: resolution index, working width (0 = full resolution)
+static void BM_HaarDetect(benchmark::State& state) {
+    FaceDetectorOptions options;
+    options.detectWidth = (int)state.range(1);
+    unique_ptr<FaceDetector> detector = createFaceDetector("haar", options);
+    if (!detector) {
+        state.SkipWithError("cannot load Haar cascade");
+        return;
+    }
+    const vector<Mat>& corpus = frames((int)state.range(0));
+    vector<Rect> faces;
+    size_t i = 0;
+    {
+        IterationStats stats(state);
+        for (auto _ : state) {
+            stats.begin();
+            detector->detect(corpus[i++ % corpus.size()], faces);
+            stats.end();
+            benchmark::DoNotOptimize(faces.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(to_string(RESOLUTIONS[state.range(0)].width) + "x" +
+                   to_string(RESOLUTIONS[state.range(0)].height));
+}
+BENCHMARK(BM_HaarDetect)
+    ->ArgsProduct({{0, 1, 2, 3}, {0, 640}})
+    ->Unit(benchmark::kMillisecond);
+
+// classifyGender() once per face. Arg: faces per frame
+static void BM_ClassifySingle(benchmark::State& state) {
+    const Mat& frame = frames(1)[0];
+    vector<Rect> faces = faceGrid((int)state.range(0));
+    Net& net = genderNet();
+    {
+        IterationStats stats(state);
+        for (auto _ : state) {
+            stats.begin();
+            for (const Rect& face : faces) benchmark::DoNotOptimize(classifyGender(net, frame(face), g_model));
+            stats.end();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)faces.size());
+}
+BENCHMARK(BM_ClassifySingle)->Arg(1)->Arg(4)->Arg(16)->Arg(32)->Unit(benchmark::kMillisecond);
+
+// blobFromImages batch. Arg: faces per frame
+static void BM_ClassifyBatch(benchmark::State& state) {
+    const Mat& frame = frames(1)[0];
+    vector<Mat> crops;
+    for (const Rect& face : faceGrid((int)state.range(0))) crops.push_back(frame(face));
+    Net& net = genderNet();
+    {
+        IterationStats stats(state);
+        for (auto _ : state) {
+            stats.begin();
+            benchmark::DoNotOptimize(classifyGenderBatch(net, crops, DEFAULT_MAX_BATCH, g_model));
+            stats.end();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)crops.size());
+}
+BENCHMARK(BM_ClassifyBatch)->Arg(1)->Arg(4)->Arg(16)->Arg(32)->Unit(benchmark::kMillisecond);
+
+// Batched, cropping straight into a reused GenderBlob. Arg: faces per frame
+static void BM_ClassifyBlob(benchmark::State& state) {
+    const Mat& frame = frames(1)[0];
+    vector<Rect> faces = faceGrid((int)state.range(0));
+    GenderBlob blob(DEFAULT_MAX_BATCH, g_model);
+    vector<GenderResult> results;
+    Net& net = genderNet();
+    {
+        IterationStats stats(state);
+        for (auto _ : state) {
+            stats.begin();
+            classifyGenderBatch(net, frame, faces, blob, results);
+            stats.end();
+            benchmark::DoNotOptimize(results.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)faces.size());
+}
+BENCHMARK(BM_ClassifyBlob)->Arg(1)->Arg(4)->Arg(16)->Arg(32)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    // Take our own flags out before Google Benchmark sees the rest
+    vector<char*> args;
+    string model, config;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "--backend=", 10) == 0) g_backend = argv[i] + 10;
+        else if (strncmp(argv[i], "--corpus=", 9) == 0) g_corpus = argv[i] + 9;
+        else if (strncmp(argv[i], "--model=", 8) == 0) model = argv[i] + 8;
+        else if (strncmp(argv[i], "--config=", 9) == 0) config = argv[i] + 9;
+        else args.push_back(argv[i]);
+    }
+    if (!model.empty()) g_model = {model, config};
+    int count = (int)args.size();
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// What a full queue does with a new item
+enum class BackpressurePolicy {
+    Block,      // producer waits for space
+    DropOldest  // oldest queued item is discarded to make room
+};
+
+// Bounded lock-free MPMC queue (Vyukov ring with per-slot sequence numbers).
+// tryPush/tryPop never block; push/pop wait with a yield/sleep back-off.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity, BackpressurePolicy policy = BackpressurePolicy::Block)
+        : slots_(capacity > 0 ? capacity : 1), policy_(policy) {
+        for (size_t i = 0; i < slots_.size(); i++)
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Enqueue without waiting; item is left untouched when the queue is full
+    bool tryPush(T&& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos % slots_.size()];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(item);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Dequeue without waiting
+    bool tryPop(T& item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos % slots_.size()];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(slot.value);
+                    slot.value = T();
+                    slot.seq.store(pos + slots_.size(), std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Enqueue according to the backpressure policy; false once the queue is closed
+    bool push(T item) {
+        Backoff backoff;
+        while (!closed()) {
+            if (tryPush(std::move(item))) return true;
+            if (policy_ == BackpressurePolicy::DropOldest) {
+                T oldest;
+                if (tryPop(oldest)) dropped_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                backoff.wait();
+            }
+        }
+        return false;
+    }
+
+    // Wait for an item; false once the queue is closed and drained
+    bool pop(T& item) {
+        Backoff backoff;
+        for (;;) {
+            if (tryPop(item)) return true;
+            if (closed()) return tryPop(item);
+            backoff.wait();
+        }
+    }
+
+    // Wake up waiters; no further pushes are accepted
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T value{};
+    };
+
+    // Spin briefly, then yield, then sleep so idle stages do not burn a core
+    struct Backoff {
+        int spins = 0;
+        void wait() {
+            if (spins < 64) {
+                spins++;
+            } else if (spins < 128) {
+                spins++;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    };
+
+    std::vector<Slot> slots_;
+    BackpressurePolicy policy_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<size_t> dropped_{0};
+};
@@ -0,0 +1,76 @@
+#include "controller.hpp"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// Weight of the newest frame in the moving average
+const double AVERAGE_ALPHA = 0.1;
+// Faces per frame once the controller first limits them
+const int FIRST_FACE_LIMIT = 16;
+
+OverloadController::OverloadController(const ControllerOptions& options, const QualitySettings& full)
+    : options_(options), budgetMs_(options.targetFps > 0 ? 1000.0 / options.targetFps : 0) {
+    QualitySettings s = full;
+    ladder_.push_back(s);
+    s.dropStale = true;
+    ladder_.push_back(s);
+
+    // One knob per rung, round robin, until every knob is at its limit
+    for (bool changed = true; changed;) {
+        changed = false;
+        if (s.detectEvery * 2 <= options_.maxDetectEvery) {
+            s.detectEvery *= 2;
+            ladder_.push_back(s);
+            changed = true;
+        }
+        if (s.detectScale * 0.75 >= options_.minDetectScale) {
+            s.detectScale *= 0.75;
+            ladder_.push_back(s);
+            changed = true;
+        }
+        int faces = s.maxFaces == 0 ? FIRST_FACE_LIMIT : s.maxFaces / 2;
+        if (faces >= options_.minFaces) {
+            s.maxFaces = faces;
+            ladder_.push_back(s);
+            changed = true;
+        }
+        if (s.maxBatch > 0 && s.maxBatch / 2 >= options_.minBatch) {
+            s.maxBatch /= 2;
+            ladder_.push_back(s);
+            changed = true;
+        }
+    }
+}
+
+void OverloadController::record(double frameMs) {
+    if (!enabled()) return;
+    averageMs_ = averageMs_ == 0 ? frameMs : averageMs_ + AVERAGE_ALPHA * (frameMs - averageMs_);
+    if (++sinceChange_ < options_.cooldown) return;
+
+    int current = level();
+    if (averageMs_ > budgetMs_ && current + 1 < (int)ladder_.size())
+        setLevel(current + 1);
+    else if (averageMs_ < budgetMs_ * options_.recoverBelow && current > 0)
+        setLevel(current - 1);
+}
+
+void OverloadController::setLevel(int level) {
+    level_.store(level, memory_order_release);
+    sinceChange_ = 0;
+    cout << "Overload control: level " << level << "/" << ladder_.size() - 1 << " at " << averageMs_
+         << " ms per frame (budget " << budgetMs_ << " ms): " << describe(ladder_[level]) << endl;
+}
+
+string describe(const QualitySettings& settings) {
+    ostringstream out;
+    out << (settings.dropStale ? "drop stale frames" : "keep all frames") << ", detect every "
+        << settings.detectEvery << ", detect scale " << settings.detectScale << ", max faces ";
+    if (settings.maxFaces > 0)
+        out << settings.maxFaces;
+    else
+        out << "all";
+    if (settings.maxBatch > 0) out << ", max batch " << settings.maxBatch;
+    return out.str();
+}
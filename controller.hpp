@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Knobs the overload controller turns, from full quality downwards
+struct QualitySettings {
+    // Skip frames at capture while the previous one is still waiting for detection
+    bool dropStale = false;
+    int detectEvery = 1;
+    // Factor applied to the detector's working width
+    double detectScale = 1.0;
+    // Faces sent to the gender net per frame, largest first (0 = all)
+    int maxFaces = 0;
+    int maxBatch = 0;
+};
+
+struct ControllerOptions {
+    // Frame rate to sustain; 0 disables the controller
+    double targetFps = 0;
+    // Limits of degradation
+    int maxDetectEvery = 8;
+    double minDetectScale = 0.4;
+    int minFaces = 2;
+    int minBatch = 4;
+    // Frames between two adjustments
+    int cooldown = 30;
+    // Recover a level once the slowest stage is below this fraction of the budget
+    double recoverBelow = 0.6;
+};
+
+// Watches how long the slowest pipeline stage spends per frame against the
+// target frame budget and steps along a ladder of cheaper settings: first stale
+// frames are dropped, then detection cadence, detection resolution, faces per
+// frame and batch size are reduced in turn. Steps back up with hysteresis.
+// record() is called from one thread; settings() from any.
+class OverloadController {
+public:
+    OverloadController(const ControllerOptions& options, const QualitySettings& full);
+
+    bool enabled() const { return options_.targetFps > 0; }
+    // Time the slowest stage spent on one frame
+    void record(double frameMs);
+
+    const QualitySettings& settings() const { return ladder_[level_.load(std::memory_order_acquire)]; }
+    int level() const { return level_.load(std::memory_order_relaxed); }
+
+private:
+    void setLevel(int level);
+
+    ControllerOptions options_;
+    std::vector<QualitySettings> ladder_;
+    std::atomic<int> level_{0};
+    double budgetMs_;
+    double averageMs_ = 0;
+    int sinceChange_ = 0;
+};
+
+// Human readable summary of settings, for logs
+std::string describe(const QualitySettings& settings);
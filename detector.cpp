@@ -0,0 +1,223 @@
+#include "detector.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <numeric>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && \
+    (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 4)))
+#define HAVE_FACE_DETECTOR_YN 1
+#endif
+
+// Stock model files, used unless FaceDetectorOptions names others
+const string FACE_CASCADE_PATH = "assets/haarcascade_frontalface_default.xml";
+const string FACE_SSD_PROTO = "models/deploy.prototxt";
+const string FACE_SSD_MODEL = "models/res10_300x300_ssd_iter_140000.caffemodel";
+const string FACE_YUNET_MODEL = "models/face_detection_yunet_2023mar.onnx";
+
+// Input geometry and mean of the SSD face detector
+const Size FACE_SSD_INPUT_SIZE(300, 300);
+const Scalar FACE_SSD_MEAN(104.0, 177.0, 123.0);
+
+Mat toWorkingResolution(const Mat& image, int width, Mat& buffer, double& scale) {
+    scale = 1.0;
+    if (width <= 0 || image.cols <= width) return image;
+    scale = (double)image.cols / width;
+    resize(image, buffer, Size(width, cvRound(image.rows / scale)), 0, 0, INTER_AREA);
+    return buffer;
+}
+
+void remapToFrame(vector<Rect>& faces, double scale, Size frameSize) {
+    Rect bounds(Point(0, 0), frameSize);
+    for (auto& face : faces) {
+        if (scale != 1.0) {
+            face = Rect(cvRound(face.x * scale), cvRound(face.y * scale),
+                        cvRound(face.width * scale), cvRound(face.height * scale));
+        }
+        face &= bounds;
+    }
+}
+
+void suppressOverlaps(vector<Rect>& boxes, const vector<int>& scores, float overlap) {
+    vector<int> order(boxes.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+    vector<Rect> kept;
+    for (int i : order) {
+        const Rect& box = boxes[i];
+        bool duplicate = any_of(kept.begin(), kept.end(), [&](const Rect& k) {
+            return (box & k).area() > overlap * min(box.area(), k.area());
+        });
+        if (!duplicate) kept.push_back(box);
+    }
+    boxes.swap(kept);
+}
+
+bool HaarFaceDetector::load(const string& path) {
+    if (!cascade_.load(path)) return false;
+    if (options_.tiles <= 1) return true;
+    // Never more workers than tile jobs or threads to run them
+    int jobs = options_.tiles * options_.tiles + 1;
+    workers_.resize((size_t)max(1, min(jobs, getNumThreads())));
+    for (auto& worker : workers_)
+        if (!worker.load(path)) return false;
+    return true;
+}
+
+void HaarFaceDetector::detect(const Mat& frame, vector<Rect>& faces) {
+    // Convert once here instead of inside detectMultiScale, then shrink
+    Mat gray = frame;
+    if (frame.channels() != 1) {
+        cvtColor(frame, gray_, COLOR_BGR2GRAY);
+        gray = gray_;
+    }
+    double scale;
+    Mat working = toWorkingResolution(gray, workingWidth(options_.detectWidth, gray.cols), small_, scale);
+
+    int minSize = cvRound(options_.minFaceSize / scale);
+    if (!workers_.empty())
+        detectTiled(working, minSize, faces);
+    else
+        cascade_.detectMultiScale(working, faces, options_.scaleFactor, options_.minNeighbors, 0,
+                                  Size(minSize, minSize));
+    remapToFrame(faces, scale, frame.size());
+}
+
+void HaarFaceDetector::detectTiled(const Mat& working, int minSize, vector<Rect>& faces) {
+    struct Job {
+        Rect roi;
+        Size minSize;
+        Size maxSize;
+    };
+    // Tiles reach overlap pixels into their neighbours, so every face up to that
+    // size lies whole inside one of them; the larger ones are left to a pass over
+    // the whole image whose pyramid starts at that size and is cheap
+    const int n = options_.tiles;
+    const Size tile((working.cols + n - 1) / n, (working.rows + n - 1) / n);
+    const int overlap = max(min(tile.width, tile.height) / 4, 2 * minSize);
+    const Rect bounds(0, 0, working.cols, working.rows);
+    vector<Job> jobs;
+    for (int ty = 0; ty < n; ty++)
+        for (int tx = 0; tx < n; tx++) {
+            Rect roi = Rect(tx * tile.width, ty * tile.height, tile.width + overlap, tile.height + overlap) & bounds;
+            if (roi.area() > 0) jobs.push_back({roi, Size(minSize, minSize), Size(overlap, overlap)});
+        }
+    int coarse = max(minSize, overlap);
+    jobs.push_back({bounds, Size(coarse, coarse), Size()});
+
+    tileFaces_.resize(jobs.size());
+    tileVotes_.resize(jobs.size());
+    // Each worker pulls jobs until none are left, on its own cascade
+    atomic<size_t> next{0};
+    const int workers = (int)min(workers_.size(), jobs.size());
+    parallel_for_(Range(0, workers), [&](const Range& range) {
+        for (int w = range.start; w < range.end; w++) {
+            for (size_t j = next++; j < jobs.size(); j = next++) {
+                const Job& job = jobs[j];
+                workers_[w].detectMultiScale(working(job.roi), tileFaces_[j], tileVotes_[j], options_.scaleFactor,
+                                             options_.minNeighbors, 0, job.minSize, job.maxSize);
+                for (Rect& face : tileFaces_[j]) face += job.roi.tl();
+            }
+        }
+    }, workers);
+
+    faces.clear();
+    vector<int> votes;
+    for (size_t j = 0; j < jobs.size(); j++) {
+        faces.insert(faces.end(), tileFaces_[j].begin(), tileFaces_[j].end());
+        votes.insert(votes.end(), tileVotes_[j].begin(), tileVotes_[j].end());
+    }
+    suppressOverlaps(faces, votes);
+}
+
+bool SsdFaceDetector::load(const string& proto, const string& model) {
+    net_ = readNetFromCaffe(proto, model);
+    return !net_.empty();
+}
+
+void SsdFaceDetector::detect(const Mat& frame, vector<Rect>& faces) {
+    faces.clear();
+    Mat blob = blobFromImage(frame, 1.0, FACE_SSD_INPUT_SIZE, FACE_SSD_MEAN, false);
+    net_.setInput(blob);
+    Mat out = net_.forward();
+
+    // 1 x 1 x N x 7: [image, label, score, x1, y1, x2, y2], coordinates normalized
+    Mat detections(out.size[2], out.size[3], CV_32F, out.ptr<float>());
+    Rect bounds(0, 0, frame.cols, frame.rows);
+    for (int i = 0; i < detections.rows; i++) {
+        const float* d = detections.ptr<float>(i);
+        if (d[2] < options_.confThreshold) continue;
+        Rect face(Point(cvRound(d[3] * frame.cols), cvRound(d[4] * frame.rows)),
+                  Point(cvRound(d[5] * frame.cols), cvRound(d[6] * frame.rows)));
+        face &= bounds;
+        if (!face.empty()) faces.push_back(face);
+    }
+}
+
+bool YuNetFaceDetector::load(const string& model) {
+#ifdef HAVE_FACE_DETECTOR_YN
+    yunet_ = FaceDetectorYN::create(model, "", Size(320, 320), options_.confThreshold);
+    return !yunet_.empty();
+#else
+    (void)model;
+    cerr << "YuNet needs OpenCV 4.5.4 or newer" << endl;
+    return false;
+#endif
+}
+
+void YuNetFaceDetector::detect(const Mat& frame, vector<Rect>& faces) {
+    faces.clear();
+#ifdef HAVE_FACE_DETECTOR_YN
+    double scale;
+    Mat working = toWorkingResolution(frame, workingWidth(options_.detectWidth, frame.cols), small_, scale);
+    if (yunet_->getInputSize() != working.size()) yunet_->setInputSize(working.size());
+    yunet_->detect(working, detections_);
+
+    // N x 15: [x, y, w, h, 5 landmarks, score]
+    for (int i = 0; i < detections_.rows; i++) {
+        const float* d = detections_.ptr<float>(i);
+        faces.emplace_back(cvRound(d[0]), cvRound(d[1]), cvRound(d[2]), cvRound(d[3]));
+    }
+    remapToFrame(faces, scale, frame.size());
+    faces.erase(remove_if(faces.begin(), faces.end(), [](const Rect& r) { return r.empty(); }),
+                faces.end());
+#else
+    (void)frame;
+#endif
+}
+
+unique_ptr<FaceDetector> createFaceDetector(const string& name, const FaceDetectorOptions& options) {
+    auto orDefault = [](const string& path, const string& stock) { return path.empty() ? stock : path; };
+    if (name == "haar") {
+        auto detector = make_unique<HaarFaceDetector>(options);
+        if (!detector->load(orDefault(options.model, FACE_CASCADE_PATH))) {
+            cerr << "Failed to load Haar cascade!" << endl;
+            return nullptr;
+        }
+        return detector;
+    }
+    if (name == "ssd") {
+        auto detector = make_unique<SsdFaceDetector>(options);
+        if (!detector->load(orDefault(options.config, FACE_SSD_PROTO), orDefault(options.model, FACE_SSD_MODEL))) {
+            cerr << "Failed to load SSD face model!" << endl;
+            return nullptr;
+        }
+        return detector;
+    }
+    if (name == "yunet") {
+        auto detector = make_unique<YuNetFaceDetector>(options);
+        if (!detector->load(orDefault(options.model, FACE_YUNET_MODEL))) {
+            cerr << "Failed to load YuNet face model!" << endl;
+            return nullptr;
+        }
+        return detector;
+    }
+    cerr << "Unknown face detector '" << name << "'" << endl;
+    return nullptr;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/objdetect.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FaceDetectorOptions {
+    // Minimum score for DNN detections
+    float confThreshold = 0.6f;
+    // Width frames are downscaled to before detection (0 = full resolution)
+    int detectWidth = 0;
+    // Haar cascade parameters; minFaceSize is in full-resolution pixels
+    double scaleFactor = 1.1;
+    int minNeighbors = 3;
+    int minFaceSize = 0;
+    // Split Haar detection into a tiles x tiles grid of overlapping tiles, plus one
+    // pass over the whole frame for faces too big for a tile, searched in parallel
+    // (1 = a single detectMultiScale call)
+    int tiles = 1;
+    // Model files replacing the detector's stock ones (config: SSD prototxt)
+    std::string model;
+    std::string config;
+};
+
+// Finds faces in a BGR frame; returned boxes are clipped to the frame
+class FaceDetector {
+public:
+    virtual ~FaceDetector() = default;
+    virtual void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) = 0;
+
+    // Shrink the working resolution by scale (<= 1) from the next frame on.
+    // Detectors with a fixed input size ignore it.
+    void setDetectScale(double scale) { detectScale_ = scale; }
+
+protected:
+    // Working width for a frame, given the configured width (0 = full resolution)
+    int workingWidth(int configured, int frameWidth) const {
+        if (detectScale_ >= 1.0) return configured;
+        return cvRound((configured > 0 ? configured : frameWidth) * detectScale_);
+    }
+
+private:
+    double detectScale_ = 1.0;
+};
+
+// OpenCV Haar cascade, run on a grayscale frame at the working resolution
+class HaarFaceDetector : public FaceDetector {
+public:
+    explicit HaarFaceDetector(const FaceDetectorOptions& options) : options_(options) {}
+    bool load(const std::string& path);
+    void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+
+private:
+    void detectTiled(const cv::Mat& working, int minSize, std::vector<cv::Rect>& faces);
+
+    FaceDetectorOptions options_;
+    cv::CascadeClassifier cascade_;
+    // One cascade per tile worker: a CascadeClassifier is not safe to share between threads
+    std::vector<cv::CascadeClassifier> workers_;
+    cv::Mat gray_;
+    cv::Mat small_;
+    std::vector<std::vector<cv::Rect>> tileFaces_;
+    std::vector<std::vector<int>> tileVotes_;
+};
+
+// ResNet10 SSD face detector (Caffe)
+class SsdFaceDetector : public FaceDetector {
+public:
+    explicit SsdFaceDetector(const FaceDetectorOptions& options) : options_(options) {}
+    bool load(const std::string& proto, const std::string& model);
+    void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+
+private:
+    FaceDetectorOptions options_;
+    cv::dnn::Net net_;
+};
+
+// YuNet face detector, see cv::FaceDetectorYN (OpenCV >= 4.5.4)
+class YuNetFaceDetector : public FaceDetector {
+public:
+    explicit YuNetFaceDetector(const FaceDetectorOptions& options) : options_(options) {}
+    bool load(const std::string& model);
+    void detect(const cv::Mat& frame, std::vector<cv::Rect>& faces) override;
+
+private:
+    FaceDetectorOptions options_;
+    cv::Ptr<cv::FaceDetectorYN> yunet_;
+    cv::Mat small_;
+    cv::Mat detections_;
+};
+
+// Downscale image into buffer so it is at most width pixels wide; returns image
+// itself when no resize is needed. scale maps working coordinates back.
+cv::Mat toWorkingResolution(const cv::Mat& image, int width, cv::Mat& buffer, double& scale);
+
+// Map boxes found at working resolution back onto a frame of frameSize
+void remapToFrame(std::vector<cv::Rect>& faces, double scale, cv::Size frameSize);
+
+// Drop boxes lying mostly (intersection over the smaller box > overlap) inside
+// a box with a higher score, e.g. duplicates of one face found by two tiles
+void suppressOverlaps(std::vector<cv::Rect>& boxes, const std::vector<int>& scores, float overlap = 0.5f);
+
+// Create a detector by name: "haar", "ssd" or "yunet". Returns nullptr on failure.
+std::unique_ptr<FaceDetector> createFaceDetector(const std::string& name,
+                                                 const FaceDetectorOptions& options);
@@ -0,0 +1,83 @@
+#include "dnn_backend.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+static const DnnBackend CPU = {"cpu", DNN_BACKEND_OPENCV, DNN_TARGET_CPU};
+static const DnnBackend CUDA = {"cuda", DNN_BACKEND_CUDA, DNN_TARGET_CUDA};
+static const DnnBackend CUDA_FP16 = {"cuda_fp16", DNN_BACKEND_CUDA, DNN_TARGET_CUDA_FP16};
+static const DnnBackend OPENVINO = {"openvino", DNN_BACKEND_INFERENCE_ENGINE, DNN_TARGET_CPU};
+static const DnnBackend OPENCL = {"opencl", DNN_BACKEND_OPENCV, DNN_TARGET_OPENCL};
+static const DnnBackend OPENCL_FP16 = {"opencl_fp16", DNN_BACKEND_OPENCV, DNN_TARGET_OPENCL_FP16};
+
+vector<DnnBackend> backendCandidates(const string& name) {
+    if (name == "auto") return {CUDA, OPENVINO, OPENCL, CPU};
+    if (name == "cuda") return {CUDA, CPU};
+    if (name == "cuda_fp16") return {CUDA_FP16, CUDA, CPU};
+    if (name == "openvino" || name == "ie") return {OPENVINO, CPU};
+    if (name == "opencl") return {OPENCL, CPU};
+    if (name == "opencl_fp16") return {OPENCL_FP16, OPENCL, CPU};
+    if (name != "cpu") cerr << "Unknown DNN backend '" << name << "', using cpu" << endl;
+    return {CPU};
+}
+
+// Whether OpenCV was built with this backend/target pair
+static bool isAvailable(const DnnBackend& candidate) {
+    if (candidate.backend == DNN_BACKEND_OPENCV && candidate.target == DNN_TARGET_CPU) return true;
+    vector<Target> targets = getAvailableTargets((Backend)candidate.backend);
+    return find(targets.begin(), targets.end(), (Target)candidate.target) != targets.end();
+}
+
+DnnBackend selectBackend(Net& net, const string& name, const Mat& probe, const string& what) {
+    for (const DnnBackend& candidate : backendCandidates(name)) {
+        if (!isAvailable(candidate)) {
+            cerr << what << ": backend " << candidate.name << " not available" << endl;
+            continue;
+        }
+        try {
+            net.setPreferableBackend(candidate.backend);
+            net.setPreferableTarget(candidate.target);
+            if (!probe.empty()) {
+                net.setInput(probe);
+                net.forward();
+            }
+            cout << what << ": using DNN backend " << candidate.name << endl;
+            return candidate;
+        } catch (const cv::Exception& e) {
+            cerr << what << ": backend " << candidate.name << " failed: " << e.what() << endl;
+        }
+    }
+    // CPU is last in every list and always available, so this is only reached if it threw
+    net.setPreferableBackend(CPU.backend);
+    net.setPreferableTarget(CPU.target);
+    cout << what << ": using DNN backend " << CPU.name << endl;
+    return CPU;
+}
+
+static void setEnv(const char* name, const string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+bool setBackendCacheDir(const string& dir) {
+    error_code ec;
+    filesystem::create_directories(filesystem::path(dir) / "ocl4dnn", ec);
+    if (ec) {
+        cerr << "Cannot create cache directory " << dir << ": " << ec.message() << endl;
+        return false;
+    }
+    // Read by OpenCV the first time OpenCL programs are built
+    setEnv("OPENCV_OPENCL_CACHE_ENABLE", "1");
+    setEnv("OPENCV_OPENCL_CACHE_DIR", dir);
+    setEnv("OPENCV_OCL4DNN_CONFIG_PATH", (filesystem::path(dir) / "ocl4dnn").string());
+    return true;
+}
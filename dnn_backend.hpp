@@ -0,0 +1,26 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <string>
+#include <vector>
+
+// An OpenCV DNN backend/target pair
+struct DnnBackend {
+    std::string name;
+    int backend;
+    int target;
+};
+
+// Candidates for a --backend value, best first, always ending with CPU.
+// Names: auto, cuda, cuda_fp16, openvino, opencl, opencl_fp16, cpu.
+std::vector<DnnBackend> backendCandidates(const std::string& name);
+
+// Put net on the first candidate that is built in and runs probe without error.
+// Logs and returns the pair actually in use.
+DnnBackend selectBackend(cv::dnn::Net& net, const std::string& name, const cv::Mat& probe,
+                         const std::string& what);
+
+// Keep compiled OpenCL programs and tuned OCL4DNN kernel configs under dir so
+// later runs skip compilation. Must be called before the first net is loaded.
+bool setBackendCacheDir(const std::string& dir);
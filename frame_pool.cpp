@@ -0,0 +1,29 @@
+#include "frame_pool.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+// Whether the pool holds the only reference to the buffer
+static bool isFree(const Mat& frame) {
+    return !frame.u || CV_XADD(&frame.u->refcount, 0) == 1;
+}
+
+FramePool::FramePool(size_t initial, size_t limit)
+    : frames_(limit > 0 ? min(initial, limit) : initial), limit_(limit) {}
+
+Mat* FramePool::acquire() {
+    for (size_t i = 0; i < frames_.size(); i++) {
+        if (!isFree(frames_[i])) continue;
+        // Free frames are taken lowest first, so i + 1 frames have held a buffer
+        if (frames_[i].empty()) raiseHighWater(metrics().framePoolHigh, i + 1);
+        return &frames_[i];
+    }
+    // Everything is in flight: grow, which only happens until the pipeline is full
+    if (limit_ > 0 && frames_.size() >= limit_) return nullptr;
+    frames_.emplace_back();
+    raiseHighWater(metrics().framePoolHigh, frames_.size());
+    return &frames_.back();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+// Recycles frame buffers between capture and the rest of the pipeline. A buffer
+// is handed out again once every Mat header referring to it has been released,
+// so steady-state capture decodes into existing memory instead of allocating.
+// Not thread-safe: owned by the capturing thread.
+class FramePool {
+public:
+    // limit caps the frames the pool ever allocates (0 = grow as needed)
+    explicit FramePool(size_t initial = 4, size_t limit = 0);
+
+    // A pool frame no one else references; read into it, then share its header.
+    // nullptr when limit frames are all still in flight.
+    cv::Mat* acquire();
+
+    size_t size() const { return frames_.size(); }
+    size_t limit() const { return limit_; }
+
+private:
+    std::vector<cv::Mat> frames_;
+    size_t limit_;
+};
@@ -0,0 +1,204 @@
+#include "gender.hpp"
+#include "dnn_backend.hpp"
+#include "metrics.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+Net loadGenderNet(const string& backend, const GenderModel& model) {
+    Net genderNet;
+    try {
+        genderNet = readNet(model.model, model.config);
+    } catch (const cv::Exception& e) {
+        cerr << e.what() << endl;
+    }
+    if (genderNet.empty()) {
+        cerr << "Failed to load gender model " << model.model << "!" << endl;
+        exit(1);
+    }
+    int shape[] = {1, 3, model.inputSize.height, model.inputSize.width};
+    Mat probe = Mat::zeros(4, shape, CV_32F);
+    selectBackend(genderNet, backend, probe, "Gender net");
+    return genderNet;
+}
+
+void warmUpGenderNets(vector<Net>& nets, const GenderModel& model, int maxBatch, int passes, bool everySize) {
+    if (passes <= 0 || nets.empty()) return;
+    vector<int> sizes = {1};
+    for (int n = 2; n <= maxBatch; n++)
+        if (everySize || n == maxBatch) sizes.push_back(n);
+
+    TickMeter timer;
+    timer.start();
+    auto warm = [&](Net& net) {
+        for (int n : sizes) {
+            int shape[] = {n, 3, model.inputSize.height, model.inputSize.width};
+            Mat blob = Mat::zeros(4, shape, CV_32F);
+            for (int pass = 0; pass < passes; pass++) {
+                net.setInput(blob);
+                net.forward();
+            }
+        }
+    };
+    if (nets.size() == 1) {
+        warm(nets[0]);
+    } else {
+        vector<thread> threads;
+        for (Net& net : nets) threads.emplace_back(warm, ref(net));
+        for (auto& t : threads) t.join();
+    }
+    timer.stop();
+    cout << "Gender net: warmed up " << nets.size() << (nets.size() == 1 ? " net at " : " nets at ") << sizes.size()
+         << " batch sizes in " << timer.getTimeMilli() << " ms" << endl;
+}
+
+void warmUpGenderNet(Net& net, const GenderModel& model, int maxBatch, int passes, bool everySize) {
+    // Net is a shared handle: warming the copy warms net
+    vector<Net> nets = {net};
+    warmUpGenderNets(nets, model, maxBatch, passes, everySize);
+}
+
+// Pick the most likely label from one row of softmax output
+static GenderResult toGenderResult(const Mat& prob, const vector<string>& labels) {
+    Point classId;
+    double confidence;
+    minMaxLoc(prob, 0, &confidence, 0, &classId);
+    string label = classId.x < (int)labels.size() ? labels[classId.x] : "class " + to_string(classId.x);
+    Mat row = prob.isContinuous() ? prob : prob.clone();
+    const float* p = row.ptr<float>();
+    return {label, (float)confidence, vector<float>(p, p + row.total())};
+}
+
+GenderResult classifyGender(Net& net, const Mat& face, const GenderModel& model) {
+    Mat blob;
+    {
+        ScopedTimer timer(Stage::Blob);
+        blob = blobFromImage(face, model.scale, model.inputSize, model.mean, model.swapRB);
+    }
+    Mat prob;
+    {
+        ScopedTimer timer(Stage::Forward);
+        net.setInput(blob);
+        prob = net.forward();
+    }
+    metrics().classified++;
+    return toGenderResult(prob.reshape(1, 1), model.labels);
+}
+
+vector<GenderResult> classifyGenderBatch(Net& net, const vector<Mat>& faces, int maxBatchSize,
+                                         const GenderModel& model) {
+    vector<GenderResult> results;
+    results.reserve(faces.size());
+    if (faces.empty()) return results;
+
+    size_t step = maxBatchSize > 0 ? (size_t)maxBatchSize : faces.size();
+    for (size_t start = 0; start < faces.size(); start += step) {
+        size_t end = min(faces.size(), start + step);
+        vector<Mat> chunk(faces.begin() + start, faces.begin() + end);
+
+        // One NCHW blob for the whole chunk, one forward pass
+        Mat blob;
+        {
+            ScopedTimer timer(Stage::Blob);
+            blob = blobFromImages(chunk, model.scale, model.inputSize, model.mean, model.swapRB);
+        }
+        Mat prob;
+        {
+            ScopedTimer timer(Stage::Forward);
+            net.setInput(blob);
+            prob = net.forward().reshape(1, (int)chunk.size());
+        }
+        metrics().classified += chunk.size();
+
+        for (int i = 0; i < prob.rows; i++)
+            results.push_back(toGenderResult(prob.row(i), model.labels));
+    }
+    return results;
+}
+
+GenderBlob::GenderBlob(int capacity, const GenderModel& model)
+    : model_(model), capacity_(0), growable_(capacity <= 0) {
+    reserve(max(capacity, 1));
+}
+
+void GenderBlob::reserve(int n) {
+    if (n <= capacity_) return;
+    int shape[] = {n, 3, model_.inputSize.height, model_.inputSize.width};
+    blob_.create(4, shape, CV_32F);
+    views_.assign(n + 1, Mat());
+    capacity_ = n;
+    raiseHighWater(metrics().blobFacesHigh, (uint64_t)n);
+}
+
+void GenderBlob::setFace(int i, const Mat& frame, const Rect& face) {
+    CV_Assert(i >= 0 && i < capacity_);
+    resize(frame(face), resized_, model_.inputSize);
+
+    // Fused normalization and HWC -> CHW into slot i; c0..c2 are the net's channels
+    const int plane = model_.inputSize.area();
+    float* c0 = blob_.ptr<float>(i);
+    float* c1 = c0 + plane;
+    float* c2 = c1 + plane;
+    const int first = model_.swapRB ? 2 : 0;
+    const int last = 2 - first;
+    const float mean0 = (float)model_.mean[0];
+    const float mean1 = (float)model_.mean[1];
+    const float mean2 = (float)model_.mean[2];
+    const float scale = (float)model_.scale;
+    for (int y = 0; y < resized_.rows; y++) {
+        const uchar* p = resized_.ptr<uchar>(y);
+        for (int x = 0; x < resized_.cols; x++, p += 3) {
+            *c0++ = (p[first] - mean0) * scale;
+            *c1++ = (p[1] - mean1) * scale;
+            *c2++ = (p[last] - mean2) * scale;
+        }
+    }
+}
+
+const Mat& GenderBlob::batch(int n) {
+    CV_Assert(n > 0 && n <= capacity_);
+    Mat& view = views_[n];
+    if (view.empty()) {
+        // Built once per batch size, then reused
+        int shape[] = {n, 3, model_.inputSize.height, model_.inputSize.width};
+        view = Mat(4, shape, CV_32F, blob_.ptr<float>());
+    }
+    return view;
+}
+
+void classifyGenderBatch(Net& net, const Mat& frame, const vector<Rect>& faces, GenderBlob& blob,
+                         vector<GenderResult>& results, int maxBatch) {
+    results.clear();
+    if (faces.empty()) return;
+    blob.fit((int)faces.size());
+
+    size_t step = (size_t)(maxBatch > 0 ? min(maxBatch, blob.capacity()) : blob.capacity());
+    for (size_t start = 0; start < faces.size(); start += step) {
+        int n = (int)(min(faces.size(), start + step) - start);
+        {
+            ScopedTimer timer(Stage::Crop);
+            for (int i = 0; i < n; i++)
+                blob.setFace(i, frame, faces[start + i]);
+        }
+        classifyGenderBlob(net, blob, n, results);
+    }
+}
+
+void classifyGenderBlob(Net& net, GenderBlob& blob, int n, vector<GenderResult>& results) {
+    Mat prob;
+    {
+        ScopedTimer timer(Stage::Forward);
+        net.setInput(blob.batch(n));
+        prob = net.forward().reshape(1, n);
+    }
+    metrics().classified += n;
+    for (int i = 0; i < n; i++)
+        results.push_back(toGenderResult(prob.row(i), blob.model().labels));
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <string>
+#include <vector>
+
+// Default number of faces sent through the gender net per forward pass
+const int DEFAULT_MAX_BATCH = 32;
+
+// Gender of one face crop
+struct GenderResult {
+    std::string label;
+    float confidence = 0.f;
+    // Score per model label (softmax output, or smoothed for tracked faces)
+    std::vector<float> probs;
+};
+
+// A tracked face's reported gender changed
+struct LabelEvent {
+    int trackId = 0;
+    // Empty when the track had no label yet
+    std::string previous;
+    std::string label;
+    float confidence = 0.f;
+};
+
+// A gender net and the input it expects; defaults are the stock Caffe model.
+// The format follows the extensions: Caffe (.caffemodel + .prototxt), ONNX
+// (.onnx, FP32, FP16 or INT8 QDQ), OpenVINO IR (.xml + .bin, e.g. an INT8 POT
+// export; needs --backend openvino) or TensorFlow (.pb).
+struct GenderModel {
+    std::string model = "models/gender_net.caffemodel";
+    std::string config = "models/deploy_gender.prototxt";
+    // Preprocessing as in cv::dnn::blobFromImage: (pixel - mean) * scale, with
+    // mean in the net's channel order
+    cv::Size inputSize = cv::Size(227, 227);
+    cv::Scalar mean = cv::Scalar(78.4263, 87.7689, 114.8958);
+    double scale = 1.0;
+    bool swapRB = false;
+    // Class names in output order
+    std::vector<std::string> labels = {"Male", "Female"};
+};
+
+// Preallocated NCHW input tensor for the gender net, reused across frames so
+// the crop path does no heap allocation once it has reached its largest batch
+class GenderBlob {
+public:
+    // capacity <= 0 grows to the largest batch seen
+    explicit GenderBlob(int capacity = DEFAULT_MAX_BATCH, const GenderModel& model = GenderModel());
+
+    const GenderModel& model() const { return model_; }
+    int capacity() const { return capacity_; }
+    void reserve(int n);
+    // Grow to n faces if the blob was created growable
+    void fit(int n) {
+        if (growable_) reserve(n);
+    }
+
+    // Resize the face region of frame straight into slot i, normalized for the model
+    void setFace(int i, const cv::Mat& frame, const cv::Rect& face);
+    // Tensor holding the first n slots
+    const cv::Mat& batch(int n);
+
+private:
+    GenderModel model_;
+    int capacity_;
+    bool growable_;
+    cv::Mat blob_;
+    cv::Mat resized_;
+    std::vector<cv::Mat> views_;
+};
+
+// Load DNN Gender Classifier on the given DNN backend (see backendCandidates)
+cv::dnn::Net loadGenderNet(const std::string& backend = "cpu", const GenderModel& model = GenderModel());
+
+// Run passes forward passes of zeros at batch sizes 1 and maxBatch, so backend
+// setup and the first kernel compilations happen before the first real frame.
+// OpenCV reallocates a net whenever its input shape changes, so other batch
+// sizes still cost an allocation on first use. everySize warms every size from
+// 1 to maxBatch instead, which pays off only where compiled kernels are cached
+// per shape (OpenCL targets).
+void warmUpGenderNet(cv::dnn::Net& net, const GenderModel& model, int maxBatch, int passes = 1,
+                     bool everySize = false);
+// The same for several nets at once, one thread each
+void warmUpGenderNets(std::vector<cv::dnn::Net>& nets, const GenderModel& model, int maxBatch, int passes = 1,
+                      bool everySize = false);
+
+// Classify gender of a single face
+GenderResult classifyGender(cv::dnn::Net& net, const cv::Mat& face, const GenderModel& model = GenderModel());
+
+// Classify all faces of a frame, maxBatchSize faces per forward pass (<= 0: all at once)
+std::vector<GenderResult> classifyGenderBatch(cv::dnn::Net& net, const std::vector<cv::Mat>& faces,
+                                              int maxBatchSize = DEFAULT_MAX_BATCH,
+                                              const GenderModel& model = GenderModel());
+
+// Same, cropping faces straight out of frame into blob; batches are blob.capacity()
+// faces, or maxBatch if that is smaller
+void classifyGenderBatch(cv::dnn::Net& net, const cv::Mat& frame, const std::vector<cv::Rect>& faces,
+                         GenderBlob& blob, std::vector<GenderResult>& results, int maxBatch = 0);
+
+// Run the first n slots of blob through net, appending one result per slot
+void classifyGenderBlob(cv::dnn::Net& net, GenderBlob& blob, int n, std::vector<GenderResult>& results);
@@ -0,0 +1,245 @@
+#include "http.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+static void closeSocket(socket_t s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+static void closeSocket(socket_t s) { ::close(s); }
+#endif
+
+using namespace std;
+
+static const char* statusText(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 503: return "Service Unavailable";
+    default: return status < 500 ? "Error" : "Internal Server Error";
+    }
+}
+
+static bool sendAll(socket_t s, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(s, data.data() + sent, (int)(data.size() - sent), 0);
+        if (n <= 0) return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+bool HttpServer::start(int port, HttpHandler handler, const string& host) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if ((intptr_t)s < 0) {
+        cerr << "HTTP: cannot create socket" << endl;
+        return false;
+    }
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    // A mistyped address must not fall back to listening on every interface
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        cerr << "HTTP: not an IPv4 address: " << host << endl;
+        closeSocket(s);
+        return false;
+    }
+    if (::bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 64) != 0) {
+        cerr << "HTTP: cannot listen on " << host << ":" << port << endl;
+        closeSocket(s);
+        return false;
+    }
+
+    handler_ = move(handler);
+    listen_ = (intptr_t)s;
+    running_ = true;
+    thread_ = thread(&HttpServer::acceptLoop, this);
+    cout << "HTTP: listening on " << host << ":" << port << endl;
+    return true;
+}
+
+void HttpServer::stop() {
+    if (!running_.exchange(false)) return;
+    if (thread_.joinable()) thread_.join();
+    closeSocket((socket_t)listen_);
+    listen_ = -1;
+    while (active_ > 0) this_thread::sleep_for(chrono::milliseconds(10));
+}
+
+void HttpServer::acceptLoop() {
+    socket_t s = (socket_t)listen_;
+    while (running_) {
+        // Poll so stop() is noticed without closing the socket under accept()
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(s, &fds);
+        timeval tv{0, 200 * 1000};
+        if (select((int)s + 1, &fds, nullptr, nullptr, &tv) <= 0) continue;
+
+        socket_t client = accept(s, nullptr, nullptr);
+        if ((intptr_t)client < 0) continue;
+        active_++;
+        thread(&HttpServer::serve, this, (intptr_t)client).detach();
+    }
+}
+
+void HttpServer::serve(intptr_t clientHandle) {
+    socket_t client = (socket_t)clientHandle;
+#ifdef _WIN32
+    DWORD timeout = 10000;
+#else
+    timeval timeout{10, 0};
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    HttpResponse response;
+    HttpRequest request;
+    string data;
+    char chunk[16384];
+    size_t headerEnd = string::npos;
+    bool ok = true;
+
+    // Headers
+    while ((headerEnd = data.find("\r\n\r\n")) == string::npos) {
+        int n = recv(client, chunk, sizeof(chunk), 0);
+        if (n <= 0 || data.size() > (1 << 16)) {
+            ok = false;
+            break;
+        }
+        data.append(chunk, (size_t)n);
+    }
+
+    if (ok) {
+        size_t lineEnd = data.find("\r\n");
+        string requestLine = data.substr(0, lineEnd);
+        size_t sp1 = requestLine.find(' ');
+        size_t sp2 = requestLine.find(' ', sp1 + 1);
+        if (sp1 == string::npos || sp2 == string::npos) {
+            ok = false;
+            response = {400, "text/plain; charset=utf-8", "bad request line\n"};
+        } else {
+            request.method = requestLine.substr(0, sp1);
+            string target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+            size_t q = target.find('?');
+            request.path = target.substr(0, q);
+            if (q != string::npos) request.query = target.substr(q + 1);
+
+            size_t pos = lineEnd + 2;
+            while (pos < headerEnd) {
+                size_t end = data.find("\r\n", pos);
+                string line = data.substr(pos, end - pos);
+                size_t colon = line.find(':');
+                if (colon != string::npos) {
+                    string name = line.substr(0, colon);
+                    transform(name.begin(), name.end(), name.begin(),
+                              [](unsigned char c) { return (char)tolower(c); });
+                    size_t v = line.find_first_not_of(' ', colon + 1);
+                    request.headers[name] = v == string::npos ? "" : line.substr(v);
+                }
+                pos = end + 2;
+            }
+        }
+    }
+
+    // Body
+    if (ok) {
+        size_t length = 0;
+        auto it = request.headers.find("content-length");
+        if (it != request.headers.end()) length = strtoull(it->second.c_str(), nullptr, 10);
+        if (length > maxBodySize) {
+            ok = false;
+            response = {413, "text/plain; charset=utf-8", "body too large\n"};
+        } else {
+            request.body = data.substr(headerEnd + 4);
+            while (request.body.size() < length) {
+                int n = recv(client, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    ok = false;
+                    break;
+                }
+                request.body.append(chunk, (size_t)n);
+            }
+            request.body.resize(min(request.body.size(), length));
+        }
+    }
+
+    if (ok) {
+        try {
+            response = handler_(request);
+        } catch (const exception& e) {
+            response = {500, "text/plain; charset=utf-8", string(e.what()) + "\n"};
+        }
+    }
+
+    if (ok || response.status != 200) {
+        string head = "HTTP/1.1 " + to_string(response.status) + " " + statusText(response.status) +
+                      "\r\nContent-Type: " + response.contentType +
+                      "\r\nContent-Length: " + to_string(response.body.size()) +
+                      "\r\nConnection: close\r\n\r\n";
+        if (sendAll(client, head)) sendAll(client, response.body);
+    }
+    closeSocket(client);
+    active_--;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+string queryParam(const string& query, const string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == string::npos) end = query.size();
+        size_t eq = query.find('=', start);
+        string key = query.substr(start, min(eq, end) - start);
+        if (key == name) {
+            string value;
+            for (size_t i = eq < end ? eq + 1 : end; i < end; i++) {
+                if (query[i] == '+') {
+                    value += ' ';
+                } else if (query[i] == '%' && i + 2 < end && hexValue(query[i + 1]) >= 0 &&
+                           hexValue(query[i + 2]) >= 0) {
+                    value += (char)(hexValue(query[i + 1]) * 16 + hexValue(query[i + 2]));
+                    i += 2;
+                } else {
+                    value += query[i];
+                }
+            }
+            return value;
+        }
+        start = end + 1;
+    }
+    return "";
+}
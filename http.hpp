@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string query;
+    // Header names are lower-cased
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string contentType = "text/plain; charset=utf-8";
+    std::string body;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+// Decoded value of name in a query string, empty when absent
+std::string queryParam(const std::string& query, const std::string& name);
+
+// Minimal HTTP/1.1 server: one request per connection, one thread per connection.
+// Enough for metrics scraping and internal RPC; not meant to face the internet.
+class HttpServer {
+public:
+    HttpServer() = default;
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    bool start(int port, HttpHandler handler, const std::string& host = "0.0.0.0");
+    // Stop accepting and wait for requests in flight
+    void stop();
+    bool running() const { return running_; }
+
+    // Largest request body accepted
+    size_t maxBodySize = 64 << 20;
+
+private:
+    void acceptLoop();
+    void serve(intptr_t client);
+
+    HttpHandler handler_;
+    intptr_t listen_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<int> active_{0};
+};
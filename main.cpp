@@ -1,90 +1,489 @@
-#include <opencv2/opencv.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/dnn.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#ifndef GENDER_HEADLESS
+#include <opencv2/highgui.hpp>
+#endif
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <iostream>
 #include <filesystem>
+#include <thread>
+
+#include "batch.hpp"
+#include "batcher.hpp"
+#include "detector.hpp"
+#include "dnn_backend.hpp"
+#include "gender.hpp"
+#include "metrics.hpp"
+#include "model_registry.hpp"
+#include "pipeline.hpp"
+#include "results.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
+#include "source.hpp"
+#include "validate.hpp"
 
 using namespace cv;
 using namespace std;
 using namespace dnn;
 
-// Paths to the models
-const string FACE_CASCADE_PATH = "assets/haarcascade_frontalface_default.xml";
-const string GENDER_PROTO = "models/deploy_gender.prototxt";
-const string GENDER_MODEL = "models/gender_net.caffemodel";
+// Command line options
+const string KEYS =
+    "{help h            |         | print this message}"
+    "{headless          | false   | no window: skip drawing and key polling, stop with Ctrl-C}"
+    "{input             |         | directory of images to process headless instead of the webcam}"
+    "{output            |         | stream per-frame results to this file (default results.jsonl for --input)}"
+    "{format            |         | results format: jsonl or csv (default: from --output extension)}"
+    "{workers           | 0       | worker threads for --input, face detectors for --serve (0 = one per core)}"
+    "{result-cache      |         | file caching --input results by perceptual hash, so reruns only process new images}"
+    "{cache-distance    | 2       | hash bits two images may differ by and still share a cached result (0-3; faces match exactly)}"
+    "{serve             | 0       | serve gender classification over HTTP on this port instead of the webcam (0 = off)}"
+    "{serve-host        | 0.0.0.0 | address --serve listens on}"
+    "{max-batch         | 32      | max faces per gender net forward pass (0 = whole frame, memory then unbounded)}"
+    "{queue-depth       | 2       | frames buffered between pipeline stages}"
+    "{max-frames        | 0       | cap on frames alive per source, queued or in use (0 = no cap, else at least --async-depth + 2)}"
+    "{backpressure      | drop    | full queue policy: drop (drop oldest frame) or block}"
+    "{models            |         | model registry file (YAML/JSON) naming extra gender nets and face models}"
+    "{gender-net        | caffe   | gender net from the model registry}"
+    "{detector          | haar    | face detector: haar, ssd (ResNet10 SSD), yunet or a registry face model}"
+    "{detector-conf     | 0.6     | min score of DNN face detections}"
+    "{detect-width      | 0       | downscale frames to this width before detection (0 = full size)}"
+    "{scale-factor      | 1.1     | Haar pyramid scale step}"
+    "{min-neighbors     | 3       | Haar neighbours needed to keep a face}"
+    "{haar-tiles        | 1       | split Haar detection into an NxN grid of tiles searched in parallel (1 = off)}"
+    "{min-face          | 0       | smallest face to detect, in full-resolution pixels}"
+    "{quality-gate      | false   | skip gender classification of tiny, blurred or badly exposed faces}"
+    "{min-crop          | 32      | shortest face side the quality gate lets through, pixels}"
+    "{min-sharpness     | 30      | Laplacian variance below which a face counts as blurred}"
+    "{min-brightness    | 40      | darkest mean gray level the quality gate accepts}"
+    "{max-brightness    | 220     | brightest mean gray level the quality gate accepts}"
+    "{track             | false   | track faces and reuse their gender between classifications}"
+    "{reclassify-every  | 30      | frames between re-classifications of a tracked face}"
+    "{track-iou         | 0.3     | min IoU to match a detection to a track}"
+    "{track-min-conf    | 0.51    | re-classify a track once its decayed confidence drops below this (keep just above 1 / classes)}"
+    "{smoothing         | none    | per-track gender smoothing: none, ema or vote (needs --track)}"
+    "{smoothing-alpha   | 0.3     | EMA weight of the newest classification}"
+    "{smoothing-window  | 5       | classifications a vote is taken over}"
+    "{label-switch      | 0.7     | smoothed score a gender needs before a track reports it}"
+    "{detect-every      | 1       | run face detection every N frames, optical flow in between}"
+    "{scene-change      | 20      | mean gray difference that forces a detection}"
+    "{motion            | false   | re-detect only where the picture changed since the last detection}"
+    "{motion-threshold  | 25      | gray level difference counted as motion}"
+    "{roi-masks         |         | one mask image per source, in --sources order (white = where faces may be)}"
+    "{target-fps        | 0       | degrade detection and classification to hold this frame rate (0 = off)}"
+    "{stats             | false   | print per-stage p50/p95/p99 latencies every --stats-interval}"
+    "{stats-overlay     | false   | draw the latency summary onto the video}"
+    "{stats-interval    | 10      | seconds per latency reporting window}"
+    "{metrics-port      | 0       | serve Prometheus metrics on this port (0 = off)}"
+    "{sources           | 0       | video sources separated by , or ;: device indices, files, RTSP/HTTP URLs or shm:<ring>}"
+    "{hw-decode         | none    | hardware video decoding: none, any, vaapi, d3d11 or mfx}"
+    "{capture-api       | any     | capture API: any, ffmpeg or gstreamer (sources are then pipelines)}"
+    "{capture-buffer    | 0       | frames the capture backend may buffer (0 = default)}"
+    "{gender-workers    | 1       | gender net instances shared by all sources}"
+    "{batch-queue       | 256     | frames waiting for a shared gender worker}"
+    "{batch-wait-ms     | 2       | how long a gender worker waits to fill a cross-stream batch}"
+    "{async-depth       | 0       | frames in gender inference at once per source (0 = wait for each frame)}"
+    "{backend           | auto    | gender net DNN backend: auto, cuda, cuda_fp16, openvino, opencl, opencl_fp16, cpu}"
+    "{warmup            | 1       | dummy forward passes at batch sizes 1 and --max-batch at startup (0 = off)}"
+    "{warmup-all-sizes  | false   | warm up every batch size up to --max-batch (pays off on OpenCL targets)}"
+    "{cache-dir         |         | keep compiled OpenCL kernels here so restarts skip compilation}"
+    "{gender-model      |         | override the --gender-net weights: .caffemodel, .onnx (FP32/FP16/INT8), .xml or .pb}"
+    "{gender-config     |         | graph file for --gender-model (.prototxt for Caffe, .bin for OpenVINO IR)}"
+    "{validate          |         | compare the chosen gender net with the FP32 Caffe model on the images in this directory}"
+    "{min-agreement     | 0.98    | label agreement --validate requires to pass}"
+    "{snapshot-dir      | .       | directory snapshots are saved to}"
+    "{snapshot-format   | jpg     | snapshot image format: jpg, png or webp}"
+    "{snapshot-quality  | -1      | JPEG/WebP quality 1-100 or PNG compression 0-9 (-1 = default)}"
+    "{snapshot-every    | 0       | seconds between automatic snapshots of frames with faces, per source (0 = off)}"
+    "{snapshot-faces    | false   | automatic snapshots save face crops instead of whole frames}"
+    "{snapshot-queue    | 32      | snapshots waiting for an encoder; the oldest is dropped beyond this}"
+    "{snapshot-workers  | 2       | snapshot encoder threads}"
+    "{reference-backend | cpu     | DNN backend of the FP32 reference model}";
+
+// One live video source and its pipeline
+struct Stream {
+    int id = 0;
+    string name;
+    string window;
+    unique_ptr<VideoCapture> cap;
+    unique_ptr<FaceDetector> detector;
+    unique_ptr<Pipeline> pipeline;
+    Mat lastFrame;
+    int64_t lastSnapshotMs = 0;
+};
+
+static atomic<bool> g_stopLive{false};
+
+extern "C" void onStopLive(int) {
+    g_stopLive = true;
+}
+
+// HighGUI calls, compiled out of headless builds
+void showFrame(const string& window, const Mat& frame) {
+#ifndef GENDER_HEADLESS
+    imshow(window, frame);
+#else
+    (void)window;
+    (void)frame;
+#endif
+}
+
+char readKey() {
+#ifndef GENDER_HEADLESS
+    return (char)waitKey(1);
+#else
+    return 0;
+#endif
+}
 
-// Labels
-const vector<string> GENDER_LIST = {"Male", "Female"};
+void closeWindows() {
+#ifndef GENDER_HEADLESS
+    destroyAllWindows();
+#endif
+}
 
-// Load DNN Gender Classifier
-Net loadGenderNet() {
-    Net genderNet = readNetFromCaffe(GENDER_PROTO, GENDER_MODEL);
-    if (genderNet.empty()) {
-        cerr << "Failed to load gender model!" << endl;
-        exit(1);
+// Draw face boxes and genders onto the frame
+void drawFaces(FramePacket& packet) {
+    for (size_t i = 0; i < packet.faces.size(); i++) {
+        const Rect& face = packet.faces[i];
+        rectangle(packet.frame, face, Scalar(0, 255, 0), 2);
+        putText(packet.frame, packet.genders[i].label, Point(face.x, face.y - 10),
+                FONT_HERSHEY_SIMPLEX, 0.8, Scalar(255, 0, 255), 2);
     }
-    return genderNet;
 }
 
-// Classify gender
-string classifyGender(Net& net, Mat& face)
- {
-    Mat blob = blobFromImage(face, 1.0, Size(227, 227), Scalar(78.4263, 87.7689, 114.8958), false);
-    net.setInput(blob);
-    Mat prob = net.forward();
-    int classId;
-    double confidence;
-    minMaxLoc(prob, 0, &confidence, 0, &classId);
-    return GENDER_LIST[classId];
+// Draw the latency summary in the top left corner
+void drawStats(Mat& frame, const vector<string>& lines) {
+    int y = 20;
+    for (const string& line : lines) {
+        putText(frame, line, Point(10, y), FONT_HERSHEY_SIMPLEX, 0.45, Scalar(0, 255, 255), 1);
+        y += 18;
+    }
 }
 
-int main() {
-    VideoCapture cap(0);
-    if (!cap.isOpened()) {
-        cerr << "Cannot open webcam!" << endl;
+// Parse --backpressure
+BackpressurePolicy parseBackpressure(const string& name) {
+    if (name == "drop") return BackpressurePolicy::DropOldest;
+    if (name == "block") return BackpressurePolicy::Block;
+    cerr << "Unknown backpressure policy '" << name << "', using drop" << endl;
+    return BackpressurePolicy::DropOldest;
+}
+
+int main(int argc, char** argv) {
+    CommandLineParser parser(argc, argv, KEYS);
+    parser.about("Gender Detection");
+    if (parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+    PipelineOptions options;
+    options.maxBatch = parser.get<int>("max-batch");
+    options.queueDepth = (size_t)max(1, parser.get<int>("queue-depth"));
+    options.policy = parseBackpressure(parser.get<string>("backpressure"));
+    options.track = parser.get<bool>("track");
+    options.tracker.reclassifyEvery = parser.get<int>("reclassify-every");
+    options.tracker.iouThreshold = parser.get<float>("track-iou");
+    options.tracker.minConfidence = parser.get<float>("track-min-conf");
+    options.tracker.smoothing.method = smoothingMethod(parser.get<string>("smoothing"));
+    options.tracker.smoothing.alpha = parser.get<float>("smoothing-alpha");
+    options.tracker.smoothing.window = parser.get<int>("smoothing-window");
+    options.tracker.smoothing.switchAt = parser.get<float>("label-switch");
+    if (options.tracker.smoothing.method != SmoothingMethod::None && !options.track) {
+        cout << "--smoothing works per track, enabling --track" << endl;
+        options.track = true;
+    }
+    options.propagator.detectEvery = parser.get<int>("detect-every");
+    options.propagator.sceneChange = parser.get<double>("scene-change");
+    options.asyncDepth = max(0, parser.get<int>("async-depth"));
+    // Besides the frames in async inference, the render loop holds one and capture
+    // decodes into another; a lower cap would serialize the stages or stall them
+    int maxFrames = parser.get<int>("max-frames");
+    options.maxFrames = maxFrames > 0 ? (size_t)max(options.asyncDepth + 2, maxFrames) : 0;
+    options.controller.targetFps = parser.get<double>("target-fps");
+    options.motion.enabled = parser.get<bool>("motion");
+    options.motion.threshold = parser.get<int>("motion-threshold");
+    options.quality.enabled = parser.get<bool>("quality-gate");
+    options.quality.minSize = parser.get<int>("min-crop");
+    options.quality.minSharpness = parser.get<double>("min-sharpness");
+    options.quality.minBrightness = parser.get<double>("min-brightness");
+    options.quality.maxBrightness = parser.get<double>("max-brightness");
+
+    FaceDetectorOptions detectorOptions;
+    detectorOptions.confThreshold = parser.get<float>("detector-conf");
+    detectorOptions.detectWidth = parser.get<int>("detect-width");
+    detectorOptions.scaleFactor = parser.get<double>("scale-factor");
+    detectorOptions.minNeighbors = parser.get<int>("min-neighbors");
+    detectorOptions.minFaceSize = parser.get<int>("min-face");
+    detectorOptions.tiles = max(1, parser.get<int>("haar-tiles"));
+    string detector = parser.get<string>("detector");
+
+    int warmup = max(0, parser.get<int>("warmup"));
+    bool warmupEverySize = parser.get<bool>("warmup-all-sizes");
+    if (parser.has("cache-dir") && !setBackendCacheDir(parser.get<string>("cache-dir"))) return -1;
+
+    ModelRegistry registry;
+    if (parser.has("models") && !registry.load(parser.get<string>("models"))) return -1;
+    const GenderModel* registered = registry.gender(parser.get<string>("gender-net"));
+    if (!registered) {
+        cerr << "Unknown gender net '" << parser.get<string>("gender-net") << "'" << endl;
+        return -1;
+    }
+    GenderModel genderModel = *registered;
+    if (parser.has("gender-model")) {
+        genderModel.model = parser.get<string>("gender-model");
+        genderModel.config = parser.has("gender-config") ? parser.get<string>("gender-config") : "";
+    }
+    if (const FaceModel* face = registry.face(detector)) {
+        detector = face->type;
+        detectorOptions.model = face->model;
+        detectorOptions.config = face->config;
+    }
+    options.genderModel = genderModel;
+
+    if (parser.has("validate")) {
+        ValidateOptions validate;
+        validate.sampleDir = parser.get<string>("validate");
+        validate.candidate = genderModel;
+        validate.backend = parser.get<string>("backend");
+        validate.referenceBackend = parser.get<string>("reference-backend");
+        validate.detector = detector;
+        validate.detectorOptions = detectorOptions;
+        validate.minAgreement = parser.get<double>("min-agreement");
+        return runValidation(validate);
+    }
+
+    MetricsReporter reporter;
+    bool statsOverlay = parser.get<bool>("stats-overlay");
+    int metricsPort = parser.get<int>("metrics-port");
+    if (parser.get<bool>("stats") || statsOverlay || metricsPort > 0) {
+        if (!reporter.start(parser.get<double>("stats-interval"), parser.get<bool>("stats"), metricsPort))
+            return -1;
+    }
+
+    if (parser.has("input")) {
+        BatchOptions batch;
+        batch.inputDir = parser.get<string>("input");
+        if (parser.has("output")) batch.outputPath = parser.get<string>("output");
+        batch.format = resultFormat(parser.get<string>("format"), batch.outputPath);
+        batch.workers = parser.get<int>("workers");
+        batch.maxBatch = options.maxBatch;
+        batch.detector = detector;
+        batch.detectorOptions = detectorOptions;
+        batch.backend = parser.get<string>("backend");
+        batch.genderModel = genderModel;
+        batch.quality = options.quality;
+        batch.warmup = warmup;
+        batch.warmupEverySize = warmupEverySize;
+        batch.cachePath = parser.get<string>("result-cache");
+        batch.cacheDistance = parser.get<int>("cache-distance");
+        return runBatch(batch);
+    }
+
+    if (parser.get<int>("serve") > 0) {
+        ServerOptions server;
+        server.port = parser.get<int>("serve");
+        server.host = parser.get<string>("serve-host");
+        server.detectors = parser.get<int>("workers");
+        server.detector = detector;
+        server.detectorOptions = detectorOptions;
+        server.batcher.maxBatch = options.maxBatch;
+        server.batcher.maxWaitMs = parser.get<double>("batch-wait-ms");
+        server.batcher.queueDepth = (size_t)max(1, parser.get<int>("batch-queue"));
+        server.batcher.workers = parser.get<int>("gender-workers");
+        server.batcher.backend = parser.get<string>("backend");
+        server.batcher.model = genderModel;
+        server.batcher.warmup = warmup;
+        server.batcher.warmupEverySize = warmupEverySize;
+        int code = runServer(server);
+        reporter.stop();
+        return code;
+    }
+
+    vector<string> sources = splitSources(parser.get<string>("sources"));
+    if (sources.empty()) {
+        cerr << "No video sources given" << endl;
         return -1;
     }
 
-    CascadeClassifier faceCascade;
-    if (!faceCascade.load(FACE_CASCADE_PATH)) {
-        cerr << "Failed to load Haar cascade!" << endl;
+    // Live results must never hold up the render loop, so the writer drops when behind
+    ResultWriter writer;
+    if (parser.has("output")) {
+        string outputPath = parser.get<string>("output");
+        if (!writer.open(outputPath, resultFormat(parser.get<string>("format"), outputPath), 1024,
+                         BackpressurePolicy::DropOldest))
+            return -1;
+    }
+
+    // One synchronous stream keeps its own gender net; several streams, or frames
+    // in flight, share a pool of worker nets and batch across submissions
+    Net genderNet;
+    unique_ptr<GenderBatcher> batcher;
+    if (sources.size() == 1 && options.asyncDepth == 0) {
+        genderNet = loadGenderNet(parser.get<string>("backend"), genderModel);
+        warmUpGenderNet(genderNet, genderModel, options.maxBatch, warmup, warmupEverySize);
+    } else {
+        BatcherOptions batcherOptions;
+        batcherOptions.maxBatch = options.maxBatch;
+        batcherOptions.maxWaitMs = parser.get<double>("batch-wait-ms");
+        batcherOptions.queueDepth = (size_t)max(1, parser.get<int>("batch-queue"));
+        batcherOptions.workers = parser.get<int>("gender-workers");
+        batcherOptions.backend = parser.get<string>("backend");
+        batcherOptions.model = genderModel;
+        batcherOptions.warmup = warmup;
+        batcherOptions.warmupEverySize = warmupEverySize;
+        batcher = make_unique<GenderBatcher>(batcherOptions);
+    }
+
+    // Encoding and disk writes happen off the render loop
+    SnapshotWriter snapshots;
+    SnapshotOptions snapshotOptions;
+    snapshotOptions.dir = parser.get<string>("snapshot-dir");
+    snapshotOptions.format = parser.get<string>("snapshot-format");
+    snapshotOptions.quality = parser.get<int>("snapshot-quality");
+    snapshotOptions.workers = parser.get<int>("snapshot-workers");
+    snapshotOptions.queueDepth = (size_t)max(1, parser.get<int>("snapshot-queue"));
+    if (!snapshots.start(snapshotOptions)) return -1;
+    const int64_t snapshotEveryMs = (int64_t)(parser.get<double>("snapshot-every") * 1000);
+    const bool snapshotFaces = parser.get<bool>("snapshot-faces");
+
+    CaptureOptions captureOptions;
+    captureOptions.hwDecode = parser.get<string>("hw-decode");
+    captureOptions.api = parser.get<string>("capture-api");
+    captureOptions.bufferSize = parser.get<int>("capture-buffer");
+
+    vector<string> roiMasks = splitSources(parser.get<string>("roi-masks"));
+    if (roiMasks.size() > sources.size()) {
+        cerr << "More --roi-masks than --sources" << endl;
         return -1;
     }
 
-    Net genderNet = loadGenderNet();
+    vector<unique_ptr<Stream>> streams;
+    for (size_t s = 0; s < sources.size(); s++) {
+        const string& spec = sources[s];
+        PipelineOptions streamOptions = options;
+        if (s < roiMasks.size()) {
+            streamOptions.motion.roi = imread(roiMasks[s], IMREAD_GRAYSCALE);
+            if (streamOptions.motion.roi.empty()) {
+                cerr << "Failed to read ROI mask " << roiMasks[s] << endl;
+                return -1;
+            }
+        }
+        auto stream = make_unique<Stream>();
+        stream->id = (int)s;
+        stream->name = sourceName(spec);
+        stream->window = sources.size() == 1 ? "Gender Detection" : "Gender Detection - " + stream->name;
+        stream->cap = openVideoSource(spec, captureOptions);
+        if (!stream->cap) return -1;
+        stream->detector = createFaceDetector(detector, detectorOptions);
+        if (!stream->detector) return -1;
+        if (warmup > 0) {
+            // DNN detectors allocate per input size; run one blank frame of the source's size
+            Size size((int)stream->cap->get(CAP_PROP_FRAME_WIDTH), (int)stream->cap->get(CAP_PROP_FRAME_HEIGHT));
+            vector<Rect> faces;
+            if (size.area() > 0) stream->detector->detect(Mat::zeros(size, CV_8UC3), faces);
+        }
+        if (batcher)
+            stream->pipeline = make_unique<Pipeline>(*stream->cap, *stream->detector, *batcher, streamOptions);
+        else
+            stream->pipeline = make_unique<Pipeline>(*stream->cap, *stream->detector, genderNet, streamOptions);
+        streams.push_back(std::move(stream));
+    }
     int frameCount = 0;
 
-    cout << "Press 's' to save image, 'q' to quit." << endl;
+#ifdef GENDER_HEADLESS
+    const bool headless = true;
+#else
+    const bool headless = parser.get<bool>("headless");
+#endif
+    if (headless) {
+        signal(SIGINT, onStopLive);
+        signal(SIGTERM, onStopLive);
+        cout << "Running headless, Ctrl-C to stop." << endl;
+    } else {
+        cout << "Press 's' to save image, 'q' to quit." << endl;
+    }
+
+    for (auto& stream : streams) stream->pipeline->start();
 
+    FramePacket packet;
     while (true) {
-        Mat frame;
-        cap >> frame;
-        if (frame.empty()) break;
+        bool running = false;
+        bool progressed = false;
+        size_t dropped = 0;
+        for (auto& stream : streams) {
+            dropped += stream->pipeline->dropped();
+            if (stream->pipeline->finished()) continue;
+            running = true;
+            if (!stream->pipeline->tryNext(packet)) continue;
+            progressed = true;
 
-        vector<Rect> faces;
-        faceCascade.detectMultiScale(frame, faces);
+            if (writer.isOpen()) {
+                FrameResult result;
+                result.source = stream->name;
+                result.frame = packet.index;
+                result.timestampMs = packet.timestampMs;
+                result.faces = packet.faces;
+                result.genders = packet.genders;
+                result.trackIds = packet.trackIds;
+                result.events = packet.events;
+                result.millis = (getTickCount() - packet.captureTicks) * 1000.0 / getTickFrequency();
+                writer.write(std::move(result));
+            }
+            metrics().stage(Stage::Frame).record((getTickCount() - packet.captureTicks) * 1000.0 / getTickFrequency());
 
-        for (auto& face : faces) {
-            Mat faceROI = frame(face);
-            resize(faceROI, faceROI, Size(227, 227));
+            if (snapshotEveryMs > 0 && !packet.faces.empty() &&
+                packet.timestampMs - stream->lastSnapshotMs >= snapshotEveryMs) {
+                stream->lastSnapshotMs = packet.timestampMs;
+                string stem = "faces_" + to_string(stream->id) + "_" + to_string(packet.index);
+                // Taken before the boxes are drawn in; headless frames are never drawn on
+                if (snapshotFaces)
+                    snapshots.saveFaces(packet.frame, packet.faces, stem);
+                else
+                    snapshots.saveFrame(headless ? packet.frame : packet.frame.clone(), stem);
+            }
+            if (headless) continue;
 
-            string gender = classifyGender(genderNet, faceROI);
-            rectangle(frame, face, Scalar(0, 255, 0), 2);
-            putText(frame, gender, Point(face.x, face.y - 10),
-                    FONT_HERSHEY_SIMPLEX, 0.8, Scalar(255, 0, 255), 2);
+            ScopedTimer timer(Stage::Render);
+            drawFaces(packet);
+            if (statsOverlay) drawStats(packet.frame, reporter.overlayLines());
+            showFrame(stream->window, packet.frame);
+            stream->lastFrame = packet.frame;
         }
+        metrics().dropped = dropped;
+        if (!running || g_stopLive) break;
 
-        imshow("Gender Detection", frame);
-        char key = (char)waitKey(1);
+        if (headless) {
+            // Nothing to poll; just avoid spinning while the pipelines are busy
+            if (!progressed) this_thread::sleep_for(chrono::microseconds(500));
+            continue;
+        }
+        char key;
+        {
+            ScopedTimer timer(Stage::WaitKey);
+            key = readKey();
+        }
         if (key == 'q') break;
 
         if (key == 's') {
-            string filename = "captured_" + to_string(frameCount++) + ".jpg";
-            imwrite(filename, frame);
-            cout << "Saved " << filename << endl;
+            for (auto& stream : streams) {
+                if (stream->lastFrame.empty()) continue;
+                string filename = snapshots.saveFrame(stream->lastFrame, "captured_" + to_string(frameCount++));
+                cout << "Saving " << filename << endl;
+            }
         }
     }
-#chiru the king of coding
-    cap.release();
-    destroyAllWindows();
+    for (auto& stream : streams) stream->pipeline->stop();
+    if (batcher) batcher->stop();
+    writer.close();
+    snapshots.stop();
+    if (snapshots.saved() > 0 || snapshots.dropped() > 0)
+        cout << "Snapshots: " << snapshots.saved() << " saved, " << snapshots.dropped() << " dropped" << endl;
+    reporter.stop();
+    for (auto& stream : streams) stream->cap->release();
+    closeWindows();
     return 1;
 }
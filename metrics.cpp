@@ -0,0 +1,182 @@
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+const double BUCKET_MIN_MS = 0.01;
+const double BUCKET_RATIO = 1.1;
+
+const char* stageName(Stage stage) {
+    static const char* names[STAGE_COUNT] = {"capture", "detect", "crop", "blob",
+                                             "forward", "render", "waitkey", "frame"};
+    return names[(int)stage];
+}
+
+Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+void LatencyHistogram::record(double ms) {
+    int bucket = 0;
+    if (ms > BUCKET_MIN_MS) bucket = min(BUCKETS - 1, (int)(log(ms / BUCKET_MIN_MS) / log(BUCKET_RATIO)));
+    counts_[bucket].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sumMicros_.fetch_add((uint64_t)(ms * 1000.0), memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    for (int i = 0; i < BUCKETS; i++) s.counts[i] = counts_[i].load(memory_order_relaxed);
+    s.count = count_.load(memory_order_relaxed);
+    s.sumMs = sumMicros_.load(memory_order_relaxed) / 1000.0;
+    return s;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snapshot::operator-(const Snapshot& earlier) const {
+    Snapshot d;
+    for (int i = 0; i < BUCKETS; i++) d.counts[i] = counts[i] - earlier.counts[i];
+    d.count = count - earlier.count;
+    d.sumMs = sumMs - earlier.sumMs;
+    return d;
+}
+
+double LatencyHistogram::Snapshot::percentile(double q) const {
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * total);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        // Geometric middle of the bucket
+        if (seen >= rank) return BUCKET_MIN_MS * pow(BUCKET_RATIO, i + 0.5);
+    }
+    return BUCKET_MIN_MS * pow(BUCKET_RATIO, BUCKETS);
+}
+
+MetricsReporter::~MetricsReporter() {
+    stop();
+}
+
+bool MetricsReporter::start(double intervalSec, bool printToStdout, int port) {
+    intervalSec_ = intervalSec > 0 ? intervalSec : 10;
+    print_ = printToStdout;
+    for (int i = 0; i < STAGE_COUNT; i++) previous_[i] = metrics().stages[i].snapshot();
+    previousFrames_ = metrics().frames;
+
+    if (port > 0) {
+        bool ok = server_.start(port, [this](const HttpRequest& request) {
+            if (request.path != "/metrics") return HttpResponse{404, "text/plain; charset=utf-8", "not found\n"};
+            return HttpResponse{200, "text/plain; version=0.0.4", prometheusText()};
+        });
+        if (!ok) return false;
+    }
+    stopping_ = false;
+    thread_ = thread(&MetricsReporter::run, this);
+    return true;
+}
+
+void MetricsReporter::stop() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    server_.stop();
+}
+
+void MetricsReporter::run() {
+    unique_lock<mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, chrono::duration<double>(intervalSec_), [this] { return stopping_; })) {
+        lock.unlock();
+        roll();
+        lock.lock();
+    }
+}
+
+void MetricsReporter::roll() {
+    Metrics& m = metrics();
+    array<LatencyHistogram::Snapshot, STAGE_COUNT> now;
+    for (int i = 0; i < STAGE_COUNT; i++) now[i] = m.stages[i].snapshot();
+    uint64_t frames = m.frames;
+
+    vector<string> lines;
+    char line[160];
+    double fps = (frames - previousFrames_) / intervalSec_;
+    uint64_t skipped = m.skippedSmall + m.skippedBlurred + m.skippedExposure;
+    snprintf(line, sizeof(line), "fps %.1f  faces %llu  classified %llu  skipped %llu  dropped %llu", fps,
+             (unsigned long long)m.faces.load(), (unsigned long long)m.classified.load(),
+             (unsigned long long)skipped, (unsigned long long)m.dropped.load());
+    lines.push_back(line);
+    if (m.framePoolHigh || m.blobFacesHigh || m.snapshotQueueHigh || m.batcherQueueHigh) {
+        snprintf(line, sizeof(line), "high water: frames %llu  blob faces %llu  snapshots %llu  batcher %llu",
+                 (unsigned long long)m.framePoolHigh.load(), (unsigned long long)m.blobFacesHigh.load(),
+                 (unsigned long long)m.snapshotQueueHigh.load(), (unsigned long long)m.batcherQueueHigh.load());
+        lines.push_back(line);
+    }
+
+    lock_guard<mutex> lock(resultMutex_);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        interval_[i] = now[i] - previous_[i];
+        if (interval_[i].count == 0) continue;
+        snprintf(line, sizeof(line), "%-8s p50 %7.2f  p95 %7.2f  p99 %7.2f ms  (n=%llu)",
+                 stageName((Stage)i), interval_[i].percentile(0.50), interval_[i].percentile(0.95),
+                 interval_[i].percentile(0.99), (unsigned long long)interval_[i].count);
+        lines.push_back(line);
+    }
+    previous_ = now;
+    previousFrames_ = frames;
+    fps_ = fps;
+    lines_ = lines;
+
+    if (print_) {
+        for (const string& l : lines_) cout << l << "\n";
+        cout << flush;
+    }
+}
+
+vector<string> MetricsReporter::overlayLines() const {
+    lock_guard<mutex> lock(resultMutex_);
+    return lines_;
+}
+
+string MetricsReporter::prometheusText() const {
+    Metrics& m = metrics();
+    ostringstream out;
+    out << "# TYPE gender_frames_total counter\ngender_frames_total " << m.frames << "\n";
+    out << "# TYPE gender_faces_total counter\ngender_faces_total " << m.faces << "\n";
+    out << "# TYPE gender_classified_total counter\ngender_classified_total " << m.classified << "\n";
+    out << "# TYPE gender_dropped_frames_total counter\ngender_dropped_frames_total " << m.dropped << "\n";
+    out << "# TYPE gender_skipped_crops_total counter\n";
+    out << "gender_skipped_crops_total{reason=\"small\"} " << m.skippedSmall << "\n";
+    out << "gender_skipped_crops_total{reason=\"blurred\"} " << m.skippedBlurred << "\n";
+    out << "gender_skipped_crops_total{reason=\"exposure\"} " << m.skippedExposure << "\n";
+    out << "# TYPE gender_buffer_high_water gauge\n";
+    out << "gender_buffer_high_water{buffer=\"frame_pool\"} " << m.framePoolHigh << "\n";
+    out << "gender_buffer_high_water{buffer=\"blob_faces\"} " << m.blobFacesHigh << "\n";
+    out << "gender_buffer_high_water{buffer=\"snapshot_queue\"} " << m.snapshotQueueHigh << "\n";
+    out << "gender_buffer_high_water{buffer=\"batcher_queue\"} " << m.batcherQueueHigh << "\n";
+
+    lock_guard<mutex> lock(resultMutex_);
+    out << "# TYPE gender_fps gauge\ngender_fps " << fps_ << "\n";
+    // Quantiles cover the last interval, sum and count are cumulative
+    out << "# TYPE gender_stage_latency_ms summary\n";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram::Snapshot total = m.stages[i].snapshot();
+        const char* name = stageName((Stage)i);
+        for (double q : {0.5, 0.95, 0.99})
+            out << "gender_stage_latency_ms{stage=\"" << name << "\",quantile=\"" << q << "\"} "
+                << interval_[i].percentile(q) << "\n";
+        out << "gender_stage_latency_ms_sum{stage=\"" << name << "\"} " << total.sumMs << "\n";
+        out << "gender_stage_latency_ms_count{stage=\"" << name << "\"} " << total.count << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http.hpp"
+
+// Timed sections of the hot path
+enum class Stage { Capture, Detect, Crop, Blob, Forward, Render, WaitKey, Frame };
+const int STAGE_COUNT = 8;
+const char* stageName(Stage stage);
+
+// Lock-free latency histogram with log-spaced buckets (10% wide, 0.01 ms .. ~40 s)
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 160;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKETS> counts{};
+        uint64_t count = 0;
+        double sumMs = 0;
+
+        // Latency at quantile q (0..1), in milliseconds
+        double percentile(double q) const;
+        Snapshot operator-(const Snapshot& earlier) const;
+    };
+
+    void record(double ms);
+    Snapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sumMicros_{0};
+};
+
+// Process-wide counters and per-stage latencies
+struct Metrics {
+    std::array<LatencyHistogram, STAGE_COUNT> stages;
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> faces{0};
+    // Faces that went through the gender net
+    std::atomic<uint64_t> classified{0};
+    // Frames discarded under backpressure
+    std::atomic<uint64_t> dropped{0};
+    // Face crops the quality gate kept from the gender net
+    std::atomic<uint64_t> skippedSmall{0};
+    std::atomic<uint64_t> skippedBlurred{0};
+    std::atomic<uint64_t> skippedExposure{0};
+    // High-water marks of the buffers that grow under bursts: frames allocated by
+    // the largest stream's pool, faces a gender blob was sized for, snapshots and
+    // batcher requests queued at once
+    std::atomic<uint64_t> framePoolHigh{0};
+    std::atomic<uint64_t> blobFacesHigh{0};
+    std::atomic<uint64_t> snapshotQueueHigh{0};
+    std::atomic<uint64_t> batcherQueueHigh{0};
+
+    LatencyHistogram& stage(Stage s) { return stages[(int)s]; }
+};
+
+Metrics& metrics();
+
+// Raise mark to value if it is higher
+inline void raiseHighWater(std::atomic<uint64_t>& mark, uint64_t value) {
+    uint64_t current = mark.load(std::memory_order_relaxed);
+    while (value > current && !mark.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Records the lifetime of the scope into a stage histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Stage stage) : stage_(stage), start_(cv::getTickCount()) {}
+    ~ScopedTimer() {
+        metrics().stage(stage_).record((cv::getTickCount() - start_) * 1000.0 / cv::getTickFrequency());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Stage stage_;
+    int64_t start_;
+};
+
+// Rolls the metrics over every interval: prints a p50/p95/p99 summary, keeps
+// overlay text for the render loop and serves Prometheus text on /metrics
+class MetricsReporter {
+public:
+    MetricsReporter() = default;
+    ~MetricsReporter();
+
+    // printToStdout: log each interval; port > 0: serve /metrics over HTTP
+    bool start(double intervalSec, bool printToStdout, int port);
+    void stop();
+
+    // Summary of the last interval, one line per stage
+    std::vector<std::string> overlayLines() const;
+    // Prometheus text exposition format
+    std::string prometheusText() const;
+
+private:
+    void run();
+    void roll();
+
+    double intervalSec_ = 10;
+    bool print_ = false;
+    HttpServer server_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    mutable std::mutex resultMutex_;
+    std::array<LatencyHistogram::Snapshot, STAGE_COUNT> previous_;
+    std::array<LatencyHistogram::Snapshot, STAGE_COUNT> interval_;
+    uint64_t previousFrames_ = 0;
+    double fps_ = 0;
+    std::vector<std::string> lines_;
+};
@@ -0,0 +1,81 @@
+#include "model_registry.hpp"
+
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+ModelRegistry::ModelRegistry() {
+    gender_["caffe"] = GenderModel();
+    // Stock files are filled in by createFaceDetector
+    for (const char* type : {"haar", "ssd", "yunet"}) face_[type] = FaceModel{type, "", ""};
+}
+
+static string readString(const FileNode& node, const string& fallback) {
+    return node.empty() ? fallback : node.string();
+}
+
+static bool readGender(const FileNode& node, GenderModel& model) {
+    model.model = readString(node["model"], "");
+    if (model.model.empty()) return false;
+    model.config = readString(node["config"], "");
+    if (!node["width"].empty()) model.inputSize.width = (int)node["width"];
+    if (!node["height"].empty()) model.inputSize.height = (int)node["height"];
+    if (!node["mean"].empty()) {
+        vector<double> mean;
+        node["mean"] >> mean;
+        if (mean.size() != 3) return false;
+        model.mean = Scalar(mean[0], mean[1], mean[2]);
+    }
+    if (!node["scale"].empty()) model.scale = (double)node["scale"];
+    if (!node["swap_rb"].empty()) model.swapRB = (int)node["swap_rb"] != 0;
+    if (!node["labels"].empty()) {
+        model.labels.clear();
+        for (const FileNode& label : node["labels"]) model.labels.push_back(label.string());
+    }
+    return model.inputSize.area() > 0 && !model.labels.empty();
+}
+
+bool ModelRegistry::load(const string& path) {
+    FileStorage fs;
+    try {
+        fs.open(path, FileStorage::READ);
+    } catch (const cv::Exception& e) {
+        cerr << e.what() << endl;
+    }
+    if (!fs.isOpened()) {
+        cerr << "Failed to read model registry " << path << endl;
+        return false;
+    }
+    for (const FileNode& node : fs["gender"]) {
+        string name = readString(node["name"], "");
+        GenderModel model;
+        if (name.empty() || !readGender(node, model)) {
+            cerr << path << ": gender model '" << name << "' needs a name, a model file, width/height, "
+                 << "three mean values and labels" << endl;
+            return false;
+        }
+        gender_[name] = model;
+    }
+    for (const FileNode& node : fs["face"]) {
+        string name = readString(node["name"], "");
+        FaceModel model{readString(node["type"], name), readString(node["model"], ""),
+                        readString(node["config"], "")};
+        if (name.empty() || model.model.empty()) {
+            cerr << path << ": face model '" << name << "' needs a name and a model file" << endl;
+            return false;
+        }
+        face_[name] = model;
+    }
+    return true;
+}
+
+const GenderModel* ModelRegistry::gender(const string& name) const {
+    auto it = gender_.find(name);
+    return it == gender_.end() ? nullptr : &it->second;
+}
+
+const FaceModel* ModelRegistry::face(const string& name) const {
+    auto it = face_.find(name);
+    return it == face_.end() ? nullptr : &it->second;
+}
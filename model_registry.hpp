@@ -0,0 +1,41 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "detector.hpp"
+#include "gender.hpp"
+
+// A face detector model: which FaceDetector runs it, and its files
+struct FaceModel {
+    std::string type;
+    std::string model;
+    std::string config;
+};
+
+// Models selectable by name, read with cv::FileStorage (YAML or JSON):
+//
+//   gender:
+//     - { name: mobilenet, model: models/gender_mobilenet.onnx,
+//         width: 128, height: 128, mean: [127.5, 127.5, 127.5], scale: 0.0078125,
+//         swap_rb: 1, labels: [Male, Female] }
+//   face:
+//     - { name: yunet-int8, type: yunet, model: models/face_detection_yunet_2023mar_int8.onnx }
+//
+// Omitted gender fields keep the stock Caffe model's values. Built in are the
+// gender net "caffe" and the face detectors "haar", "ssd" and "yunet".
+class ModelRegistry {
+public:
+    ModelRegistry();
+
+    // Add or replace entries from a registry file
+    bool load(const std::string& path);
+
+    // nullptr for unknown names
+    const GenderModel* gender(const std::string& name) const;
+    const FaceModel* face(const std::string& name) const;
+
+private:
+    std::map<std::string, GenderModel> gender_;
+    std::map<std::string, FaceModel> face_;
+};
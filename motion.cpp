@@ -0,0 +1,106 @@
+#include "motion.hpp"
+#include "detector.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+MotionGate::MotionGate(const MotionOptions& options) : options_(options) {}
+
+void MotionGate::prepareRoi(Size frameSize) {
+    roiRegions_.clear();
+    smallRoi_.release();
+    if (options_.roi.empty()) {
+        roi_.release();
+        roiRegions_.push_back(Rect(Point(), frameSize));
+        return;
+    }
+    Mat mask = options_.roi;
+    if (mask.channels() > 1) cvtColor(mask, mask, COLOR_BGR2GRAY);
+    resize(mask, roi_, frameSize, 0, 0, INTER_NEAREST);
+    threshold(roi_, roi_, 0, 255, THRESH_BINARY);
+
+    // Detect over the bounding boxes of the mask's blobs
+    Mat contoursInput = roi_.clone();
+    findContours(contoursInput, contours_, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+    for (const auto& contour : contours_) roiRegions_.push_back(boundingRect(contour));
+    mergeOverlapping(roiRegions_);
+}
+
+bool MotionGate::update(const Mat& frame, vector<Rect>& regions) {
+    if (frame.size() != frameSize_) {
+        frameSize_ = frame.size();
+        prepareRoi(frameSize_);
+        prevGray_.release();
+    }
+    if (!options_.enabled) {
+        regions = roiRegions_;
+        return true;
+    }
+
+    Mat working = toWorkingResolution(frame, options_.width, small_, scale_);
+    cvtColor(working, gray_, COLOR_BGR2GRAY);
+    GaussianBlur(gray_, gray_, Size(5, 5), 0);
+
+    bool refresh = prevGray_.empty() || (options_.refreshEvery > 0 && ++sinceRefresh_ >= options_.refreshEvery);
+    if (refresh) {
+        sinceRefresh_ = 0;
+        swap(prevGray_, gray_);
+        regions = roiRegions_;
+        return true;
+    }
+
+    // Changed pixels inside the ROI, grown into blobs
+    absdiff(gray_, prevGray_, diff_);
+    threshold(diff_, diff_, options_.threshold, 255, THRESH_BINARY);
+    if (!roi_.empty()) {
+        if (smallRoi_.size() != diff_.size()) resize(roi_, smallRoi_, diff_.size(), 0, 0, INTER_NEAREST);
+        bitwise_and(diff_, smallRoi_, diff_);
+    }
+    dilate(diff_, diff_, Mat(), Point(-1, -1), 2);
+    findContours(diff_, contours_, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+    regions.clear();
+    const double minArea = options_.minArea * (double)diff_.total();
+    const Rect bounds(Point(), frameSize_);
+    for (const auto& contour : contours_) {
+        Rect r = boundingRect(contour);
+        if (r.area() >= minArea) regions.push_back(r);
+    }
+    // Back to frame coordinates, padded so a face reaching out of the blob still fits
+    remapToFrame(regions, scale_, frameSize_);
+    size_t kept = 0;
+    for (const Rect& r : regions) {
+        int pad = max(r.width, r.height) / 2;
+        Rect box = Rect(r.x - pad, r.y - pad, r.width + 2 * pad, r.height + 2 * pad) & bounds;
+        if (box.area() > 0) regions[kept++] = box;
+    }
+    regions.resize(kept);
+    mergeOverlapping(regions);
+    swap(prevGray_, gray_);
+    return false;
+}
+
+bool MotionGate::inRoi(const Rect& face) const {
+    if (roi_.empty()) return true;
+    Point center(face.x + face.width / 2, face.y + face.height / 2);
+    if (!Rect(Point(), roi_.size()).contains(center)) return false;
+    return roi_.ptr<uchar>(center.y)[center.x] != 0;
+}
+
+void mergeOverlapping(vector<Rect>& rects) {
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                if ((rects[i] & rects[j]).area() == 0) continue;
+                rects[i] |= rects[j];
+                rects.erase(rects.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+}
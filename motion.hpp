@@ -0,0 +1,56 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+struct MotionOptions {
+    // Only re-detect where the picture changed
+    bool enabled = false;
+    // Where faces may appear (non-zero pixels), any size; empty = whole frame
+    cv::Mat roi;
+    // Width of the gray frames differenced against each other
+    int width = 320;
+    // Per-pixel gray difference counted as motion
+    int threshold = 25;
+    // Smallest changed area worth a detection, as a fraction of the frame
+    double minArea = 0.0005;
+    // Detect over the whole ROI every N detections (0 = only on the first frame)
+    int refreshEvery = 100;
+};
+
+// Decides where the face detector has to look: the ROI, narrowed down to the
+// regions that moved since the last detection
+class MotionGate {
+public:
+    explicit MotionGate(const MotionOptions& options = MotionOptions());
+
+    // Whether detection is restricted at all
+    bool active() const { return options_.enabled || !options_.roi.empty(); }
+
+    // Regions of frame, in frame coordinates, to run the detector on. Returns
+    // true on a refresh, where they cover the whole ROI and previous faces are
+    // void; otherwise faces found earlier outside the regions still stand.
+    bool update(const cv::Mat& frame, std::vector<cv::Rect>& regions);
+
+    // Whether a face found in frame lies in the ROI
+    bool inRoi(const cv::Rect& face) const;
+
+private:
+    void prepareRoi(cv::Size frameSize);
+
+    MotionOptions options_;
+    cv::Size frameSize_;
+    cv::Mat roi_;
+    cv::Mat smallRoi_;
+    std::vector<cv::Rect> roiRegions_;
+    cv::Mat small_;
+    cv::Mat gray_;
+    cv::Mat prevGray_;
+    cv::Mat diff_;
+    std::vector<std::vector<cv::Point>> contours_;
+    double scale_ = 1.0;
+    int sinceRefresh_ = 0;
+};
+
+// Merge overlapping rectangles in place until none overlap
+void mergeOverlapping(std::vector<cv::Rect>& rects);
@@ -0,0 +1,300 @@
+#include "pipeline.hpp"
+#include "metrics.hpp"
+#include "results.hpp"
+#include "shm_ring.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+// Settings the controller starts from; batch size is only adjustable on an own net
+static QualitySettings fullQuality(const PipelineOptions& options, bool ownNet) {
+    QualitySettings full;
+    full.detectEvery = max(1, options.propagator.detectEvery);
+    full.maxBatch = ownNet ? options.maxBatch : 0;
+    return full;
+}
+
+Pipeline::Pipeline(VideoCapture& cap, FaceDetector& faceDetector, Net& genderNet,
+                   const PipelineOptions& options)
+    : cap_(cap), faceDetector_(faceDetector), genderNet_(&genderNet), options_(options),
+      framePool_(options.queueDepth * 3 + 4, options.maxFrames),
+      genderBlob_(options.maxBatch, options.genderModel),
+      controller_(options.controller, fullQuality(options, true)),
+      propagator_(options.propagator),
+      gate_(options.motion),
+      quality_(options.quality),
+      tracker_(options.tracker, options.genderModel.labels),
+      captured_(options.queueDepth, options.policy),
+      detected_(options.queueDepth, options.policy),
+      classified_(options.queueDepth, options.policy),
+      zeroCopy_(dynamic_cast<SharedMemoryCapture*>(&cap) != nullptr) {}
+
+Pipeline::Pipeline(VideoCapture& cap, FaceDetector& faceDetector, GenderBatcher& batcher,
+                   const PipelineOptions& options)
+    : cap_(cap), faceDetector_(faceDetector), batcher_(&batcher), options_(options),
+      framePool_(options.queueDepth * 3 + 4, options.maxFrames),
+      genderBlob_(1),
+      controller_(options.controller, fullQuality(options, false)),
+      propagator_(options.propagator),
+      gate_(options.motion),
+      quality_(options.quality),
+      tracker_(options.tracker, options.genderModel.labels),
+      captured_(options.queueDepth, options.policy),
+      detected_(options.queueDepth, options.policy),
+      classified_(options.queueDepth, options.policy),
+      zeroCopy_(dynamic_cast<SharedMemoryCapture*>(&cap) != nullptr) {}
+
+Pipeline::~Pipeline() {
+    stop();
+}
+
+void Pipeline::start() {
+    running_ = true;
+    threads_.emplace_back(&Pipeline::captureStage, this);
+    threads_.emplace_back(&Pipeline::detectStage, this);
+    if (options_.asyncDepth > 0 && batcher_)
+        threads_.emplace_back(&Pipeline::classifyAsyncStage, this);
+    else
+        threads_.emplace_back(&Pipeline::classifyStage, this);
+}
+
+bool Pipeline::next(FramePacket& packet) {
+    return classified_.pop(packet);
+}
+
+void Pipeline::stop() {
+    running_ = false;
+    captured_.close();
+    detected_.close();
+    classified_.close();
+    for (auto& t : threads_)
+        if (t.joinable()) t.join();
+    threads_.clear();
+}
+
+size_t Pipeline::dropped() const {
+    return captured_.dropped() + detected_.dropped() + classified_.dropped() + stale_;
+}
+
+void Pipeline::captureStage() {
+    for (int64_t index = 0; running_; index++) {
+        // Behind under overload: skip this frame rather than queue it
+        if (controller_.settings().dropStale && captured_.size() > 0) {
+            if (!cap_.grab()) break;
+            stale_++;
+            continue;
+        }
+        FramePacket packet;
+        packet.index = index;
+        // Decode into a recycled buffer; downstream stages share its header. Ring
+        // frames already are one, and pooling them would pin their slots.
+        Mat* buffer = zeroCopy_ ? &packet.frame : framePool_.acquire();
+        // Every frame the cap allows is still in flight: wait for one under Block, else skip this one
+        while (!buffer && options_.policy == BackpressurePolicy::Block && running_) {
+            this_thread::sleep_for(chrono::microseconds(500));
+            buffer = framePool_.acquire();
+        }
+        if (!buffer) {
+            if (!running_ || !cap_.grab()) break;
+            stale_++;
+            continue;
+        }
+        {
+            ScopedTimer timer(Stage::Capture);
+            cap_.read(*buffer);
+            packet.frame = *buffer;
+        }
+        if (packet.frame.empty()) break;
+        packet.captureTicks = getTickCount();
+        packet.timestampMs = wallClockMs();
+        if (!captured_.push(std::move(packet))) break;
+    }
+    captured_.close();
+}
+
+void Pipeline::detectStage() {
+    FramePacket packet;
+    while (captured_.pop(packet)) {
+        int64_t start = getTickCount();
+        {
+            ScopedTimer timer(Stage::Detect);
+            const QualitySettings& quality = controller_.settings();
+            faceDetector_.setDetectScale(quality.detectScale);
+            propagator_.setDetectEvery(quality.detectEvery);
+            packet.detected = propagator_.beginFrame(packet.frame);
+            if (packet.detected) {
+                if (gate_.active())
+                    detectInRegions(packet);
+                else
+                    faceDetector_.detect(packet.frame, packet.faces);
+                propagator_.detected(packet.faces);
+            } else {
+                propagator_.propagate(packet.faces);
+            }
+        }
+        packet.detectMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+        if (!detected_.push(std::move(packet))) break;
+    }
+    detected_.close();
+}
+
+void Pipeline::detectInRegions(FramePacket& packet) {
+    bool refresh = gate_.update(packet.frame, regions_);
+
+    // Faces clear of every changed region still stand from the last detection
+    packet.faces.clear();
+    if (!refresh) {
+        for (const Rect& face : lastFaces_) {
+            bool changed = any_of(regions_.begin(), regions_.end(),
+                                  [&](const Rect& region) { return (face & region).area() > 0; });
+            if (!changed) packet.faces.push_back(face);
+        }
+    }
+    for (const Rect& region : regions_) {
+        faceDetector_.detect(packet.frame(region), regionFaces_);
+        for (Rect face : regionFaces_) {
+            face += region.tl();
+            if (gate_.inRoi(face)) packet.faces.push_back(face);
+        }
+    }
+    lastFaces_ = packet.faces;
+}
+
+void Pipeline::classifyStage() {
+    FramePacket packet;
+    while (detected_.pop(packet)) {
+        int64_t start = getTickCount();
+        // Faces are cropped straight into the reused input tensor
+        prepare(packet, pending_, pendingFaces_);
+        classify(packet.frame, pendingFaces_, pendingGenders_);
+        finish(packet, pending_, pendingGenders_);
+        controller_.record(max(packet.detectMs, (getTickCount() - start) * 1000.0 / getTickFrequency()));
+        metrics().frames++;
+        metrics().faces += packet.faces.size();
+        if (!classified_.push(std::move(packet))) break;
+    }
+    classified_.close();
+}
+
+// Keeps up to asyncDepth frames submitted to the batcher, so cropping and
+// submitting frame N+1 overlaps the forward pass of frame N. Frames still
+// leave in capture order.
+void Pipeline::classifyAsyncStage() {
+    deque<InFlight> inFlight;
+    FramePacket packet;
+    vector<Rect> pendingFaces;
+    bool open = true;
+    while (open) {
+        if (!detected_.tryPop(packet)) {
+            // Retire finished frames while waiting: under --max-frames capture may
+            // be waiting for exactly those buffers to come back
+            if (!inFlight.empty()) {
+                if (inFlight.front().genders.wait_for(chrono::microseconds(200)) == future_status::ready) {
+                    open = retire(inFlight.front());
+                    inFlight.pop_front();
+                }
+                continue;
+            }
+            if (!detected_.closed()) {
+                this_thread::sleep_for(chrono::microseconds(200));
+                continue;
+            }
+            if (!detected_.tryPop(packet)) break;
+        }
+        int64_t start = getTickCount();
+        double detectMs = packet.detectMs;
+        InFlight next;
+        prepare(packet, next.pending, pendingFaces);
+        next.genders = batcher_->submit(packet.frame, pendingFaces);
+        next.packet = std::move(packet);
+        inFlight.push_back(std::move(next));
+
+        // Hand over whatever has completed, and wait once too many are outstanding
+        while (open && !inFlight.empty() &&
+               ((int)inFlight.size() > options_.asyncDepth ||
+                inFlight.front().genders.wait_for(chrono::seconds(0)) == future_status::ready)) {
+            open = retire(inFlight.front());
+            inFlight.pop_front();
+        }
+        controller_.record(max(detectMs, (getTickCount() - start) * 1000.0 / getTickFrequency()));
+    }
+    while (open && !inFlight.empty()) {
+        open = retire(inFlight.front());
+        inFlight.pop_front();
+    }
+    classified_.close();
+}
+
+bool Pipeline::retire(InFlight& inFlight) {
+    FramePacket& packet = inFlight.packet;
+    finish(packet, inFlight.pending, inFlight.genders.get());
+    metrics().frames++;
+    metrics().faces += packet.faces.size();
+    return classified_.push(std::move(packet));
+}
+
+// Keep the maxFaces largest of candidates, in their original order
+static void keepLargest(const vector<Rect>& faces, vector<int>& candidates, int maxFaces) {
+    if (maxFaces <= 0 || candidates.size() <= (size_t)maxFaces) return;
+    nth_element(candidates.begin(), candidates.begin() + maxFaces, candidates.end(),
+                [&](int a, int b) { return faces[a].area() > faces[b].area(); });
+    candidates.resize(maxFaces);
+    sort(candidates.begin(), candidates.end());
+}
+
+void Pipeline::prepare(FramePacket& packet, vector<int>& pending, vector<Rect>& pendingFaces) {
+    pending.clear();
+    pendingFaces.clear();
+    if (options_.track) {
+        tracker_.update(packet.faces, faceTracks_);
+        packet.trackIds.clear();
+        for (size_t i = 0; i < packet.faces.size(); i++) {
+            packet.trackIds.push_back(tracker_.tracks()[faceTracks_[i]].id);
+            // Only new tracks and tracks with a stale gender go through the net
+            if (tracker_.needsClassification(faceTracks_[i])) pending.push_back((int)i);
+        }
+    } else {
+        for (size_t i = 0; i < packet.faces.size(); i++) pending.push_back((int)i);
+    }
+
+    // Crops not worth a forward pass stay unknown, and the smallest faces wait
+    // under overload; tracked ones are retried next frame
+    quality_.filter(packet.frame, packet.faces, pending);
+    keepLargest(packet.faces, pending, controller_.settings().maxFaces);
+    for (int i : pending) {
+        if (options_.track) tracker_.markPending(faceTracks_[i]);
+        pendingFaces.push_back(packet.faces[i]);
+    }
+}
+
+void Pipeline::finish(FramePacket& packet, const vector<int>& pending, const vector<GenderResult>& genders) {
+    // Faces left out of this frame's classification stay unknown unless tracked
+    packet.genders.assign(packet.faces.size(), GenderResult());
+    for (size_t k = 0; k < pending.size(); k++) packet.genders[pending[k]] = genders[k];
+    if (!options_.track) return;
+
+    packet.events.clear();
+    LabelEvent event;
+    for (size_t k = 0; k < pending.size(); k++)
+        if (tracker_.setGender(packet.trackIds[pending[k]], genders[k], event)) packet.events.push_back(event);
+    // Tracks may have been dropped since the frame was submitted; their faces
+    // keep this frame's own result
+    for (size_t i = 0; i < packet.faces.size(); i++) {
+        const Track* track = tracker_.find(packet.trackIds[i]);
+        if (track && track->classified) packet.genders[i] = track->gender;
+    }
+}
+
+void Pipeline::classify(const Mat& frame, const vector<Rect>& faces, vector<GenderResult>& genders) {
+    if (!batcher_)
+        classifyGenderBatch(*genderNet_, frame, faces, genderBlob_, genders, controller_.settings().maxBatch);
+    else if (faces.empty())
+        genders.clear();
+    else
+        genders = batcher_->submit(frame, faces).get();
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/videoio.hpp>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "batcher.hpp"
+#include "bounded_queue.hpp"
+#include "controller.hpp"
+#include "detector.hpp"
+#include "frame_pool.hpp"
+#include "gender.hpp"
+#include "motion.hpp"
+#include "quality.hpp"
+#include "tracker.hpp"
+
+// One frame travelling through the pipeline
+struct FramePacket {
+    int64_t index = 0;
+    // cv::getTickCount() and wall clock (ms since epoch) at capture
+    int64_t captureTicks = 0;
+    int64_t timestampMs = 0;
+    cv::Mat frame;
+    std::vector<cv::Rect> faces;
+    std::vector<GenderResult> genders;
+    // Track id per face when tracking is enabled
+    std::vector<int> trackIds;
+    // Tracks whose reported gender changed on this frame
+    std::vector<LabelEvent> events;
+    // false when the faces were propagated from earlier frames instead of detected
+    bool detected = true;
+    // Time the detect stage spent on the frame
+    double detectMs = 0;
+};
+
+struct PipelineOptions {
+    size_t queueDepth = 2;
+    BackpressurePolicy policy = BackpressurePolicy::DropOldest;
+    // Frames of this stream alive at once, queued or held downstream (0 = no cap).
+    // At the cap capture waits under Block and skips frames under DropOldest.
+    size_t maxFrames = 0;
+    int maxBatch = DEFAULT_MAX_BATCH;
+    // Preprocessing of the pipeline's own gender net
+    GenderModel genderModel;
+    // Track faces and reuse their gender instead of classifying every frame
+    bool track = false;
+    TrackerOptions tracker;
+    // Run the detector every N frames and propagate boxes in between
+    PropagatorOptions propagator;
+    // Frames whose gender results may be outstanding while later frames are
+    // cropped and submitted; 0 waits for each frame. Needs a batcher.
+    int asyncDepth = 0;
+    // Degrade detection and classification to hold a target frame rate
+    ControllerOptions controller;
+    // Restrict detection to a region of interest and to what moved
+    MotionOptions motion;
+    // Keep tiny, blurred and badly exposed crops from the gender net
+    QualityOptions quality;
+};
+
+// Capture -> face detection -> gender classification, each on its own thread.
+// The render/output stage is whoever calls next(), so GUI calls stay on that thread.
+class Pipeline {
+public:
+    // Classify with a gender net owned by this pipeline's classify thread
+    Pipeline(cv::VideoCapture& cap, FaceDetector& faceDetector, cv::dnn::Net& genderNet,
+             const PipelineOptions& options);
+    // Classify through a batcher shared with other pipelines
+    Pipeline(cv::VideoCapture& cap, FaceDetector& faceDetector, GenderBatcher& batcher,
+             const PipelineOptions& options);
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    void start();
+    // Next fully processed frame; false once the source ended or stop() was called
+    bool next(FramePacket& packet);
+    // Same without waiting
+    bool tryNext(FramePacket& packet) { return classified_.tryPop(packet); }
+    // Source ended and every frame has been taken
+    bool finished() const { return classified_.closed() && classified_.size() == 0; }
+    void stop();
+
+    // Frames discarded by DropOldest queues, or skipped at capture under overload
+    size_t dropped() const;
+
+private:
+    // A frame submitted to the batcher whose genders have not been collected yet
+    struct InFlight {
+        FramePacket packet;
+        // Faces sent to the net
+        std::vector<int> pending;
+        std::future<std::vector<GenderResult>> genders;
+    };
+
+    void captureStage();
+    void detectStage();
+    void detectInRegions(FramePacket& packet);
+    void classifyStage();
+    void classifyAsyncStage();
+    // Classification split around the forward pass: pick the faces that need
+    // the net, then merge its results back into the tracks and the packet
+    void prepare(FramePacket& packet, std::vector<int>& pending, std::vector<cv::Rect>& pendingFaces);
+    void finish(FramePacket& packet, const std::vector<int>& pending, const std::vector<GenderResult>& genders);
+    bool retire(InFlight& inFlight);
+    void classify(const cv::Mat& frame, const std::vector<cv::Rect>& faces,
+                  std::vector<GenderResult>& genders);
+
+    cv::VideoCapture& cap_;
+    FaceDetector& faceDetector_;
+    cv::dnn::Net* genderNet_ = nullptr;
+    GenderBatcher* batcher_ = nullptr;
+    PipelineOptions options_;
+    FramePool framePool_;
+    GenderBlob genderBlob_;
+    OverloadController controller_;
+    FacePropagator propagator_;
+    MotionGate gate_;
+    CropQualityGate quality_;
+    std::vector<cv::Rect> regions_;
+    std::vector<cv::Rect> regionFaces_;
+    std::vector<cv::Rect> lastFaces_;
+    FaceTracker tracker_;
+    std::vector<int> faceTracks_;
+    std::vector<int> pending_;
+    std::vector<cv::Rect> pendingFaces_;
+    std::vector<GenderResult> pendingGenders_;
+
+    BoundedQueue<FramePacket> captured_;
+    BoundedQueue<FramePacket> detected_;
+    BoundedQueue<FramePacket> classified_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> stale_{0};
+    // Frames come from a SharedMemoryCapture and already live in shared memory
+    bool zeroCopy_ = false;
+};
@@ -0,0 +1,42 @@
+#include "quality.hpp"
+#include "metrics.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+CropVerdict CropQualityGate::check(const Mat& frame, const Rect& face) {
+    Rect box = face & Rect(0, 0, frame.cols, frame.rows);
+    if (min(box.width, box.height) < max(1, options_.minSize)) return CropVerdict::TooSmall;
+
+    // Cheapest first: exposure needs only the mean of the shrunk crop
+    resize(frame(box), small_, Size(options_.measureSize, options_.measureSize), 0, 0, INTER_AREA);
+    if (small_.channels() > 1)
+        cvtColor(small_, gray_, COLOR_BGR2GRAY);
+    else
+        gray_ = small_;
+    double brightness = mean(gray_)[0];
+    if (brightness < options_.minBrightness || brightness > options_.maxBrightness) return CropVerdict::BadExposure;
+
+    Laplacian(gray_, laplacian_, CV_16S);
+    Scalar mu, sigma;
+    meanStdDev(laplacian_, mu, sigma);
+    if (sigma[0] * sigma[0] < options_.minSharpness) return CropVerdict::Blurred;
+    return CropVerdict::Ok;
+}
+
+void CropQualityGate::filter(const Mat& frame, const vector<Rect>& faces, vector<int>& candidates) {
+    if (!options_.enabled) return;
+    size_t kept = 0;
+    for (int i : candidates) {
+        switch (check(frame, faces[i])) {
+        case CropVerdict::Ok: candidates[kept++] = i; break;
+        case CropVerdict::TooSmall: metrics().skippedSmall++; break;
+        case CropVerdict::Blurred: metrics().skippedBlurred++; break;
+        case CropVerdict::BadExposure: metrics().skippedExposure++; break;
+        }
+    }
+    candidates.resize(kept);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+struct QualityOptions {
+    bool enabled = false;
+    // Shortest face side worth classifying, frame pixels
+    int minSize = 32;
+    // Variance of the Laplacian below which a crop counts as blurred
+    double minSharpness = 30.0;
+    // Range the mean gray level must fall in
+    double minBrightness = 40.0;
+    double maxBrightness = 220.0;
+    // Crops are measured at this size, so the thresholds do not depend on face size
+    int measureSize = 64;
+};
+
+// Why a face crop was not sent to the gender net
+enum class CropVerdict { Ok, TooSmall, Blurred, BadExposure };
+
+// Cheap checks run before the gender net so tiny, blurred, too dark or
+// overexposed faces do not cost a forward pass for a result no one will use.
+// Skipped crops are counted in metrics(). Not thread-safe.
+class CropQualityGate {
+public:
+    explicit CropQualityGate(const QualityOptions& options = QualityOptions()) : options_(options) {}
+
+    CropVerdict check(const cv::Mat& frame, const cv::Rect& face);
+    // Drop from candidates (indices into faces) the crops that fail; a no-op when disabled
+    void filter(const cv::Mat& frame, const std::vector<cv::Rect>& faces, std::vector<int>& candidates);
+
+private:
+    QualityOptions options_;
+    cv::Mat small_;
+    cv::Mat gray_;
+    cv::Mat laplacian_;
+};
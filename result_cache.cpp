@@ -0,0 +1,273 @@
+#include "result_cache.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// Log layout, host byte order: magic, version, signature, then records
+//   'I' hash aspect count {x y w h label confidence}*count
+//   'F' hash label confidence
+// where label is a u16 length and its bytes. A record cut short by a crash ends the log.
+const uint32_t CACHE_MAGIC = 0x31434447;  // "GDC1"
+const uint32_t CACHE_VERSION = 1;
+
+// Relative aspect ratio difference up to which a cached image's boxes are reused
+const float ASPECT_TOLERANCE = 0.02f;
+
+uint64_t perceptualHash(const Mat& image) {
+    Mat gray, small, pixels, freq;
+    if (image.channels() == 3)
+        cvtColor(image, gray, COLOR_BGR2GRAY);
+    else if (image.channels() == 4)
+        cvtColor(image, gray, COLOR_BGRA2GRAY);
+    else
+        gray = image;
+    resize(gray, small, Size(32, 32), 0, 0, INTER_AREA);
+    small.convertTo(pixels, CV_32F);
+    dct(pixels, freq);
+
+    float coeffs[64];
+    for (int y = 0; y < 8; y++)
+        for (int x = 0; x < 8; x++) coeffs[y * 8 + x] = freq.at<float>(y, x);
+    // Median of the AC terms; the DC term only says how bright the image is
+    float ac[63];
+    copy(coeffs + 1, coeffs + 64, ac);
+    nth_element(ac, ac + 31, ac + 63);
+    const float median = ac[31];
+
+    uint64_t hash = 0;
+    for (int i = 1; i < 64; i++)
+        if (coeffs[i] > median) hash |= 1ull << i;
+    return hash;
+}
+
+int hammingDistance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    int bits = 0;
+    for (; x; bits++) x &= x - 1;
+    return bits;
+}
+
+template <typename T>
+static void writeValue(ostream& out, const T& value) {
+    out.write((const char*)&value, sizeof(value));
+}
+
+template <typename T>
+static bool readValue(istream& in, T& value) {
+    return (bool)in.read((char*)&value, sizeof(value));
+}
+
+static void writeLabel(ostream& out, const GenderResult& gender) {
+    uint16_t length = (uint16_t)min<size_t>(gender.label.size(), 0xffff);
+    writeValue(out, length);
+    out.write(gender.label.data(), length);
+    writeValue(out, gender.confidence);
+}
+
+static bool readLabel(istream& in, GenderResult& gender) {
+    uint16_t length;
+    if (!readValue(in, length)) return false;
+    gender.label.resize(length);
+    return in.read(&gender.label[0], length) && readValue(in, gender.confidence);
+}
+
+ResultCache::~ResultCache() {
+    close();
+}
+
+bool ResultCache::open(const string& path, const string& signature, int maxDistance) {
+    close();
+    lock_guard<mutex> lock(mutex_);
+    maxDistance_ = max(0, min(maxDistance, MAX_DISTANCE));
+    images_.clear();
+    faces_.clear();
+    for (auto& band : imageIndex_) band.clear();
+    for (auto& band : faceIndex_) band.clear();
+    bool reuse = load(path, signature);
+    log_.open(path, ios::binary | (reuse ? ios::app : ios::trunc));
+    if (!log_) {
+        cerr << "Cannot write result cache " << path << endl;
+        return false;
+    }
+    if (!reuse) {
+        writeValue(log_, CACHE_MAGIC);
+        writeValue(log_, CACHE_VERSION);
+        writeValue(log_, (uint32_t)signature.size());
+        log_.write(signature.data(), (streamsize)signature.size());
+        log_.flush();
+    }
+    cout << "Result cache " << path << ": " << images_.size() << " images, " << faces_.size() << " faces" << endl;
+    return true;
+}
+
+bool ResultCache::load(const string& path, const string& signature) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    uint32_t magic, version, length;
+    if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, length) || magic != CACHE_MAGIC ||
+        version != CACHE_VERSION || length > 1 << 20) {
+        cerr << "Result cache " << path << " is not a cache of this version, starting over" << endl;
+        return false;
+    }
+    string stored(length, '\0');
+    if (!in.read(&stored[0], length)) return false;
+    if (stored != signature) {
+        cout << "Result cache " << path << " was built with other models or settings, starting over" << endl;
+        return false;
+    }
+
+    // Keep every complete record; a torn tail is overwritten by the next appends
+    streampos good = in.tellg();
+    char type;
+    while (readValue(in, type)) {
+        if (type == 'I') {
+            ImageEntry entry;
+            uint32_t count;
+            if (!readValue(in, entry.hash) || !readValue(in, entry.aspect) || !readValue(in, count) || count > 1 << 16)
+                break;
+            entry.faces.resize(count);
+            entry.genders.resize(count);
+            bool ok = true;
+            for (uint32_t i = 0; i < count && ok; i++) {
+                Rect2f& f = entry.faces[i];
+                ok = readValue(in, f.x) && readValue(in, f.y) && readValue(in, f.width) && readValue(in, f.height) &&
+                     readLabel(in, entry.genders[i]);
+            }
+            if (!ok) break;
+            addToIndex(imageIndex_, entry.hash, (uint32_t)images_.size());
+            images_.push_back(std::move(entry));
+        } else if (type == 'F') {
+            FaceEntry entry;
+            if (!readValue(in, entry.hash) || !readLabel(in, entry.gender)) break;
+            addToIndex(faceIndex_, entry.hash, (uint32_t)faces_.size());
+            faces_.push_back(std::move(entry));
+        } else {
+            break;
+        }
+        good = in.tellg();
+    }
+    in.close();
+    // Drop a torn tail so appends start on a record boundary
+    if (good != (streampos)-1) {
+        error_code error;
+        std::filesystem::resize_file(path, (uintmax_t)good, error);
+    }
+    return true;
+}
+
+void ResultCache::close() {
+    lock_guard<mutex> lock(mutex_);
+    if (log_.is_open()) log_.close();
+}
+
+size_t ResultCache::images() const {
+    lock_guard<mutex> lock(mutex_);
+    return images_.size();
+}
+
+void ResultCache::addToIndex(BandIndex& index, uint64_t hash, uint32_t entry) {
+    for (int b = 0; b < 4; b++) index[b][(uint16_t)(hash >> (16 * b))].push_back(entry);
+}
+
+template <typename Entry, typename Accept>
+const Entry* ResultCache::nearest(const vector<Entry>& entries, const BandIndex& index, uint64_t hash,
+                                  int maxDistance, Accept accept) const {
+    const Entry* best = nullptr;
+    int bestDistance = maxDistance + 1;
+    for (int b = 0; b < 4; b++) {
+        auto bucket = index[b].find((uint16_t)(hash >> (16 * b)));
+        if (bucket == index[b].end()) continue;
+        for (uint32_t i : bucket->second) {
+            int distance = hammingDistance(entries[i].hash, hash);
+            if (distance < bestDistance && accept(entries[i])) {
+                best = &entries[i];
+                bestDistance = distance;
+            }
+        }
+    }
+    return best;
+}
+
+bool ResultCache::findImage(uint64_t hash, Size size, vector<Rect>& faces, vector<GenderResult>& genders) {
+    lock_guard<mutex> lock(mutex_);
+    const float aspect = (float)size.width / max(1, size.height);
+    const ImageEntry* entry = nearest(images_, imageIndex_, hash, maxDistance_, [&](const ImageEntry& e) {
+        return fabs(e.aspect - aspect) <= ASPECT_TOLERANCE * aspect;
+    });
+    if (!entry) return false;
+    const Rect bounds(0, 0, size.width, size.height);
+    faces.clear();
+    for (const Rect2f& f : entry->faces)
+        faces.push_back(Rect(cvRound(f.x * size.width), cvRound(f.y * size.height), cvRound(f.width * size.width),
+                             cvRound(f.height * size.height)) & bounds);
+    genders = entry->genders;
+    imageHits_++;
+    return true;
+}
+
+void ResultCache::storeImage(uint64_t hash, Size size, const vector<Rect>& faces, const vector<GenderResult>& genders) {
+    ImageEntry entry;
+    entry.hash = hash;
+    entry.aspect = (float)size.width / max(1, size.height);
+    for (size_t i = 0; i < faces.size(); i++) {
+        const Rect& f = faces[i];
+        entry.faces.push_back(Rect2f((float)f.x / size.width, (float)f.y / size.height, (float)f.width / size.width,
+                                     (float)f.height / size.height));
+        GenderResult gender = i < genders.size() ? genders[i] : GenderResult();
+        gender.probs.clear();
+        entry.genders.push_back(gender);
+    }
+    lock_guard<mutex> lock(mutex_);
+    append(entry);
+    addToIndex(imageIndex_, hash, (uint32_t)images_.size());
+    images_.push_back(std::move(entry));
+}
+
+bool ResultCache::findFace(uint64_t hash, GenderResult& gender) {
+    lock_guard<mutex> lock(mutex_);
+    const FaceEntry* entry = nearest(faces_, faceIndex_, hash, 0, [](const FaceEntry&) { return true; });
+    if (!entry) return false;
+    gender = entry->gender;
+    faceHits_++;
+    return true;
+}
+
+void ResultCache::storeFace(uint64_t hash, const GenderResult& gender) {
+    // Unknown genders are what skipped crops get; nothing worth remembering
+    if (gender.label.empty()) return;
+    FaceEntry entry{hash, gender};
+    entry.gender.probs.clear();
+    lock_guard<mutex> lock(mutex_);
+    append(entry);
+    addToIndex(faceIndex_, hash, (uint32_t)faces_.size());
+    faces_.push_back(std::move(entry));
+}
+
+void ResultCache::append(const ImageEntry& entry) {
+    if (!log_.is_open()) return;
+    writeValue(log_, 'I');
+    writeValue(log_, entry.hash);
+    writeValue(log_, entry.aspect);
+    writeValue(log_, (uint32_t)entry.faces.size());
+    for (size_t i = 0; i < entry.faces.size(); i++) {
+        const Rect2f& f = entry.faces[i];
+        writeValue(log_, f.x);
+        writeValue(log_, f.y);
+        writeValue(log_, f.width);
+        writeValue(log_, f.height);
+        writeLabel(log_, entry.genders[i]);
+    }
+}
+
+void ResultCache::append(const FaceEntry& entry) {
+    if (!log_.is_open()) return;
+    writeValue(log_, 'F');
+    writeValue(log_, entry.hash);
+    writeLabel(log_, entry.gender);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gender.hpp"
+
+// 64-bit DCT perceptual hash of an image: the signs of its lowest 8x8 frequencies
+// against their median, so rescaled, recompressed or lightly edited copies hash
+// within a few bits of each other
+uint64_t perceptualHash(const cv::Mat& image);
+
+int hammingDistance(uint64_t a, uint64_t b);
+
+// Batch-mode results keyed by perceptual hash, for whole images (faces and
+// genders, skipping detection and the gender net) and for single face crops
+// (skipping the net). Persisted as an append-only log, so a rerun over a corpus
+// only processes what is new. Thread-safe.
+class ResultCache {
+public:
+    // Hashes up to this far apart are matched exactly by the band index
+    static const int MAX_DISTANCE = 3;
+
+    ResultCache() = default;
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Load the log at path and append to it. signature names the detector and
+    // gender net settings; a log written under others is started over.
+    // maxDistance applies to whole images only: face crops share one layout, so
+    // different people's crops hash close together and must match exactly.
+    bool open(const std::string& path, const std::string& signature, int maxDistance = 2);
+    void close();
+
+    // Faces and genders of a cached image with this hash and aspect ratio, scaled to size
+    bool findImage(uint64_t hash, cv::Size size, std::vector<cv::Rect>& faces, std::vector<GenderResult>& genders);
+    void storeImage(uint64_t hash, cv::Size size, const std::vector<cv::Rect>& faces,
+                    const std::vector<GenderResult>& genders);
+
+    bool findFace(uint64_t hash, GenderResult& gender);
+    void storeFace(uint64_t hash, const GenderResult& gender);
+
+    size_t imageHits() const { return imageHits_; }
+    size_t faceHits() const { return faceHits_; }
+    size_t images() const;
+
+private:
+    struct ImageEntry {
+        uint64_t hash;
+        float aspect;
+        // Boxes as fractions of the image size
+        std::vector<cv::Rect2f> faces;
+        std::vector<GenderResult> genders;
+    };
+    struct FaceEntry {
+        uint64_t hash;
+        GenderResult gender;
+    };
+    // Entry indices by each 16-bit quarter of the hash: two hashes at most
+    // MAX_DISTANCE bits apart agree on at least one quarter
+    using BandIndex = std::array<std::unordered_map<uint16_t, std::vector<uint32_t>>, 4>;
+
+    static void addToIndex(BandIndex& index, uint64_t hash, uint32_t entry);
+    template <typename Entry, typename Accept>
+    const Entry* nearest(const std::vector<Entry>& entries, const BandIndex& index, uint64_t hash, int maxDistance,
+                         Accept accept) const;
+    bool load(const std::string& path, const std::string& signature);
+    void append(const ImageEntry& entry);
+    void append(const FaceEntry& entry);
+
+    mutable std::mutex mutex_;
+    int maxDistance_ = 2;
+    std::vector<ImageEntry> images_;
+    std::vector<FaceEntry> faces_;
+    BandIndex imageIndex_;
+    BandIndex faceIndex_;
+    std::ofstream log_;
+    std::atomic<size_t> imageHits_{0};
+    std::atomic<size_t> faceHits_{0};
+};
@@ -0,0 +1,178 @@
+#include "results.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+ResultFormat resultFormat(const string& name, const string& path) {
+    if (name == "csv") return ResultFormat::Csv;
+    if (name == "jsonl" || name == "json") return ResultFormat::Jsonl;
+    if (!name.empty()) cerr << "Unknown result format '" << name << "', using jsonl" << endl;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) return ResultFormat::Csv;
+    return ResultFormat::Jsonl;
+}
+
+int64_t wallClockMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+ResultWriter::~ResultWriter() {
+    close();
+}
+
+bool ResultWriter::open(const string& path, ResultFormat format, size_t queueDepth,
+                        BackpressurePolicy policy) {
+    close();
+    // Large stream buffer: results leave in few big writes instead of one per line
+    buffer_.resize(1 << 20);
+    out_.rdbuf()->pubsetbuf(buffer_.data(), (streamsize)buffer_.size());
+    out_.open(path);
+    if (!out_) {
+        cerr << "Cannot write " << path << endl;
+        return false;
+    }
+    format_ = format;
+    if (format_ == ResultFormat::Csv)
+        out_ << CSV_HEADER;
+
+    queue_ = make_unique<BoundedQueue<FrameResult>>(queueDepth, policy);
+    thread_ = thread(&ResultWriter::run, this);
+    return true;
+}
+
+void ResultWriter::write(FrameResult result) {
+    if (queue_) queue_->push(std::move(result));
+}
+
+void ResultWriter::close() {
+    if (!thread_.joinable()) return;
+    queue_->close();
+    thread_.join();
+    out_.close();
+}
+
+void ResultWriter::run() {
+    FrameResult result;
+    string line;
+    while (queue_->pop(result)) {
+        line.clear();
+        formatResult(result, format_, line);
+        out_ << line;
+        written_++;
+        // Nothing else waiting: hand what we have to the OS
+        if (queue_->size() == 0) out_.flush();
+    }
+    out_.flush();
+}
+
+// Quote a string for JSON
+static void appendJson(string& line, const string& s) {
+    line += '"';
+    for (char c : s) {
+        switch (c) {
+        case '"': line += "\\\""; break;
+        case '\\': line += "\\\\"; break;
+        case '\n': line += "\\n"; break;
+        case '\r': line += "\\r"; break;
+        case '\t': line += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                line += esc;
+            } else {
+                line += c;
+            }
+        }
+    }
+    line += '"';
+}
+
+// Quote a string for CSV
+static void appendCsv(string& line, const string& s) {
+    line += '"';
+    for (char c : s) {
+        if (c == '"') line += '"';
+        line += c;
+    }
+    line += '"';
+}
+
+static void appendFixed(string& line, double v, int digits) {
+    char num[32];
+    snprintf(num, sizeof(num), "%.*f", digits, v);
+    line += num;
+}
+
+void formatResult(const FrameResult& r, ResultFormat format, string& line) {
+    if (format == ResultFormat::Jsonl) {
+        line += "{\"source\":";
+        appendJson(line, r.source);
+        line += ",\"frame\":" + to_string(r.frame);
+        line += r.ok ? ",\"ok\":true" : ",\"ok\":false";
+        line += ",\"timestamp_ms\":" + to_string(r.timestampMs);
+        line += ",\"millis\":";
+        appendFixed(line, r.millis, 3);
+        line += ",\"faces\":[";
+        for (size_t i = 0; i < r.faces.size(); i++) {
+            const Rect& f = r.faces[i];
+            if (i) line += ',';
+            line += "{\"box\":[" + to_string(f.x) + ',' + to_string(f.y) + ',' + to_string(f.width) +
+                    ',' + to_string(f.height) + ']';
+            if (i < r.trackIds.size()) line += ",\"track\":" + to_string(r.trackIds[i]);
+            if (i < r.genders.size()) {
+                line += ",\"gender\":";
+                appendJson(line, r.genders[i].label);
+                line += ",\"confidence\":";
+                appendFixed(line, r.genders[i].confidence, 4);
+            }
+            line += '}';
+        }
+        line += ']';
+        if (!r.events.empty()) {
+            line += ",\"events\":[";
+            for (size_t i = 0; i < r.events.size(); i++) {
+                const LabelEvent& e = r.events[i];
+                if (i) line += ',';
+                line += "{\"track\":" + to_string(e.trackId) + ",\"from\":";
+                appendJson(line, e.previous);
+                line += ",\"to\":";
+                appendJson(line, e.label);
+                line += ",\"confidence\":";
+                appendFixed(line, e.confidence, 4);
+                line += '}';
+            }
+            line += ']';
+        }
+        line += "}\n";
+        return;
+    }
+
+    // CSV: one row per face; frames without faces still get a row
+    size_t rows = max<size_t>(1, r.faces.size());
+    for (size_t i = 0; i < rows; i++) {
+        appendCsv(line, r.source);
+        line += ',' + to_string(r.frame) + (r.ok ? ",ok," : ",error,") + to_string(r.timestampMs) + ',';
+        if (i < r.faces.size()) {
+            const Rect& f = r.faces[i];
+            if (i < r.trackIds.size()) line += to_string(r.trackIds[i]);
+            line += ',' + to_string(f.x) + ',' + to_string(f.y) + ',' + to_string(f.width) + ',' +
+                    to_string(f.height) + ',';
+            if (i < r.genders.size()) {
+                line += r.genders[i].label + ',';
+                appendFixed(line, r.genders[i].confidence, 4);
+            } else {
+                line += ',';
+            }
+        } else {
+            line += ",,,,,,";
+        }
+        line += ',';
+        appendFixed(line, r.millis, 3);
+        line += '\n';
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "gender.hpp"
+
+enum class ResultFormat { Jsonl, Csv };
+
+// Format named by --format, or guessed from the output file extension when name is empty
+ResultFormat resultFormat(const std::string& name, const std::string& path);
+
+// Everything known about one processed frame or image
+struct FrameResult {
+    std::string source;
+    int64_t frame = -1;
+    bool ok = true;
+    // Wall clock time the frame was captured or the image was read, ms since epoch
+    int64_t timestampMs = 0;
+    std::vector<cv::Rect> faces;
+    std::vector<GenderResult> genders;
+    std::vector<int> trackIds;
+    // Label changes of tracked faces (JSONL only)
+    std::vector<LabelEvent> events;
+    // Processing time of the frame
+    double millis = 0;
+};
+
+// Milliseconds since the epoch
+int64_t wallClockMs();
+
+// First line of CSV results
+const char* const CSV_HEADER = "source,frame,status,timestamp_ms,track,x,y,width,height,gender,confidence,millis\n";
+
+// Append result as one JSON line, or one CSV row per face (header: CSV_HEADER)
+void formatResult(const FrameResult& result, ResultFormat format, std::string& line);
+
+// Formats and writes results on its own thread so output I/O never blocks inference
+class ResultWriter {
+public:
+    ResultWriter() = default;
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    // policy decides what happens when the disk cannot keep up: Block loses nothing,
+    // DropOldest keeps the producer going
+    bool open(const std::string& path, ResultFormat format, size_t queueDepth = 1024,
+              BackpressurePolicy policy = BackpressurePolicy::Block);
+    bool isOpen() const { return thread_.joinable(); }
+
+    void write(FrameResult result);
+    // Flush everything queued so far and stop the writer thread
+    void close();
+
+    size_t written() const { return written_; }
+    size_t dropped() const { return queue_ ? queue_->dropped() : 0; }
+
+private:
+    void run();
+
+    std::ofstream out_;
+    std::vector<char> buffer_;
+    ResultFormat format_ = ResultFormat::Jsonl;
+    std::unique_ptr<BoundedQueue<FrameResult>> queue_;
+    std::thread thread_;
+    std::atomic<size_t> written_{0};
+};
@@ -0,0 +1,143 @@
+#include "server.hpp"
+#include "bounded_queue.hpp"
+#include "http.hpp"
+#include "metrics.hpp"
+#include "results.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+
+static atomic<bool> g_stopServer{false};
+
+extern "C" void onStopSignal(int) {
+    g_stopServer = true;
+}
+
+// Face detectors are not thread-safe; request threads borrow one at a time
+class DetectorPool {
+public:
+    DetectorPool(size_t size) : free_(size, BackpressurePolicy::Block) {}
+    void add(unique_ptr<FaceDetector> detector) { free_.push(std::move(detector)); }
+
+    void detect(const Mat& image, vector<Rect>& faces) {
+        unique_ptr<FaceDetector> detector;
+        free_.pop(detector);
+        try {
+            detector->detect(image, faces);
+        } catch (...) {
+            free_.push(std::move(detector));
+            throw;
+        }
+        free_.push(std::move(detector));
+    }
+
+private:
+    BoundedQueue<unique_ptr<FaceDetector>> free_;
+};
+
+// Parse "x,y,w,h;x,y,w,h" and clip to bounds; false on malformed or empty boxes
+static bool parseBoxes(const string& spec, const Rect& bounds, vector<Rect>& boxes) {
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(';', start);
+        if (end == string::npos) end = spec.size();
+        Rect box;
+        if (sscanf(spec.substr(start, end - start).c_str(), "%d,%d,%d,%d", &box.x, &box.y, &box.width,
+                   &box.height) != 4)
+            return false;
+        box &= bounds;
+        if (box.area() <= 0) return false;
+        boxes.push_back(box);
+        start = end + 1;
+    }
+    return true;
+}
+
+static HttpResponse badRequest(const string& message) {
+    return HttpResponse{400, "text/plain; charset=utf-8", message + "\n"};
+}
+
+int runServer(const ServerOptions& options) {
+    int detectors = options.detectors > 0 ? options.detectors : (int)max(1u, thread::hardware_concurrency());
+    DetectorPool pool((size_t)detectors);
+    for (int i = 0; i < detectors; i++) {
+        unique_ptr<FaceDetector> detector = createFaceDetector(options.detector, options.detectorOptions);
+        if (!detector) return -1;
+        pool.add(std::move(detector));
+    }
+    GenderBatcher batcher(options.batcher);
+    atomic<int64_t> requests{0};
+
+    HttpHandler handler = [&](const HttpRequest& request) {
+        if (request.path == "/healthz") return HttpResponse{200, "text/plain; charset=utf-8", "ok\n"};
+        if (request.path != "/v1/classify") return HttpResponse{404, "text/plain; charset=utf-8", "not found\n"};
+        if (request.method != "POST") return HttpResponse{405, "text/plain; charset=utf-8", "POST an image\n"};
+
+        int64_t start = getTickCount();
+        FrameResult result;
+        result.source = queryParam(request.query, "source");
+        if (result.source.empty()) result.source = "request";
+        result.frame = requests++;
+        result.timestampMs = wallClockMs();
+
+        if (request.body.empty()) return badRequest("empty body");
+        Mat encoded(1, (int)request.body.size(), CV_8U, (void*)request.body.data());
+        Mat image = imdecode(encoded, IMREAD_COLOR);
+        if (image.empty()) return badRequest("body is not a supported image");
+
+        Rect bounds(0, 0, image.cols, image.rows);
+        string boxes = queryParam(request.query, "boxes");
+        try {
+            if (queryParam(request.query, "crop") == "1") {
+                result.faces.push_back(bounds);
+            } else if (!boxes.empty()) {
+                if (!parseBoxes(boxes, bounds, result.faces)) return badRequest("boxes must be x,y,w,h;...");
+            } else {
+                ScopedTimer timer(Stage::Detect);
+                pool.detect(image, result.faces);
+            }
+            result.genders = batcher.submit(image, result.faces).get();
+        } catch (const cv::Exception& e) {
+            return HttpResponse{500, "text/plain; charset=utf-8", string(e.what()) + "\n"};
+        }
+        result.millis = (getTickCount() - start) * 1000.0 / getTickFrequency();
+        metrics().stage(Stage::Frame).record(result.millis);
+        metrics().frames++;
+        metrics().faces += result.faces.size();
+
+        HttpResponse response;
+        if (queryParam(request.query, "format") == "csv") {
+            response.contentType = "text/csv";
+            response.body = CSV_HEADER;
+            formatResult(result, ResultFormat::Csv, response.body);
+        } else {
+            response.contentType = "application/json";
+            formatResult(result, ResultFormat::Jsonl, response.body);
+        }
+        return response;
+    };
+
+    HttpServer server;
+    if (!server.start(options.port, handler, options.host)) return -1;
+    cout << "Serving gender classification on " << options.host << ":" << options.port << endl;
+
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    while (!g_stopServer) this_thread::sleep_for(chrono::milliseconds(100));
+
+    cout << "Shutting down after " << requests << " requests" << endl;
+    server.stop();
+    batcher.stop();
+    return 0;
+}
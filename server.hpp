@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include "batcher.hpp"
+#include "detector.hpp"
+
+struct ServerOptions {
+    int port = 8080;
+    std::string host = "0.0.0.0";
+    // Face detectors shared by request threads (0 = one per core)
+    int detectors = 0;
+    std::string detector = "haar";
+    FaceDetectorOptions detectorOptions;
+    // Gender nets and cross-request batching
+    BatcherOptions batcher;
+};
+
+// Serve gender classification over HTTP until SIGINT/SIGTERM:
+//
+//   POST /v1/classify           body: an encoded image; faces are detected
+//   POST /v1/classify?crop=1    the image is a single pre-cropped face
+//   POST /v1/classify?boxes=x,y,w,h;...   classify the given boxes
+//   GET  /healthz
+//
+// Optional ?source= names the result and ?format=csv switches from JSON.
+// Faces of concurrent requests are batched together. Returns the exit code.
+int runServer(const ServerOptions& options);
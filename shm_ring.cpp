@@ -0,0 +1,273 @@
+#include "shm_ring.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+static size_t alignUp(size_t n, size_t alignment) {
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+static size_t slotsOffset() {
+    return alignUp(sizeof(ShmRingHeader), 64);
+}
+
+static size_t pixelsOffset(uint32_t slots) {
+    return alignUp(slotsOffset() + slots * sizeof(ShmSlot), 4096);
+}
+
+size_t shmRingSize(uint32_t slots, uint64_t slotBytes) {
+    return pixelsOffset(slots) + slots * slotBytes;
+}
+
+bool ShmMapping::map(const string& name, size_t size) {
+    unmap();
+#ifdef _WIN32
+    (void)name;
+    (void)size;
+    cerr << "Shared-memory frame rings are not supported on Windows" << endl;
+    return false;
+#else
+    // "/name" is a POSIX shared-memory object, any other path a plain file
+    bool shm = name.size() > 1 && name[0] == '/' && name.find('/', 1) == string::npos;
+    int flags = size > 0 ? O_RDWR | O_CREAT : O_RDWR;
+    int fd = shm ? shm_open(name.c_str(), flags, 0660) : ::open(name.c_str(), flags, 0660);
+    if (fd < 0) return false;
+    if (size > 0) {
+        if (ftruncate(fd, (off_t)size) != 0) {
+            ::close(fd);
+            return false;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+    data_ = data;
+    size_ = size;
+    return true;
+#endif
+}
+
+void ShmMapping::unmap() {
+#ifndef _WIN32
+    if (data_) munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+ShmSlot* ShmMapping::slot(uint64_t i) const {
+    return (ShmSlot*)((char*)data_ + slotsOffset()) + i;
+}
+
+uchar* ShmMapping::pixels(uint64_t i) const {
+    return (uchar*)data_ + pixelsOffset(header()->slots) + i * header()->slotBytes;
+}
+
+bool ShmFrameWriter::create(const string& name, Size size, int type, uint32_t slots) {
+    // Detection and cropping downstream take 8-bit BGR only
+    if (type != CV_8UC3 || size.width <= 0 || size.height <= 0) {
+        cerr << "Frame ring " << name << " needs non-empty 8-bit BGR frames" << endl;
+        return false;
+    }
+    size_t step = (size_t)size.width * CV_ELEM_SIZE(type);
+    uint64_t slotBytes = alignUp(step * size.height, 64);
+    if (slots == 0 || !mapping_.map(name, shmRingSize(slots, slotBytes))) {
+        cerr << "Cannot create frame ring " << name << endl;
+        return false;
+    }
+    // Consumers only trust the ring once the magic is published, last
+    ShmRingHeader* header = mapping_.header();
+    header->magic.store(0, memory_order_relaxed);
+    header->slots = slots;
+    header->width = size.width;
+    header->height = size.height;
+    header->type = type;
+    header->step = (uint32_t)step;
+    header->slotBytes = slotBytes;
+    header->written.store(0, memory_order_relaxed);
+    header->closed.store(0, memory_order_relaxed);
+    for (uint32_t i = 0; i < slots; i++) {
+        mapping_.slot(i)->state.store(SHM_FREE, memory_order_relaxed);
+        mapping_.slot(i)->seq.store(0, memory_order_relaxed);
+    }
+    header->magic.store(SHM_RING_MAGIC, memory_order_release);
+    next_ = 0;
+    return true;
+}
+
+Mat ShmFrameWriter::beginWrite() {
+    ShmRingHeader* header = mapping_.header();
+    uint64_t index = next_ % header->slots;
+    ShmSlot* slot = mapping_.slot(index);
+    uint32_t state = slot->state.load(memory_order_acquire);
+    if (state == SHM_READING || !slot->state.compare_exchange_strong(state, SHM_WRITING, memory_order_acq_rel))
+        return Mat();
+    writing_ = slot;
+    return Mat(header->height, header->width, header->type, mapping_.pixels(index), header->step);
+}
+
+void ShmFrameWriter::commit(int64_t timestampMs) {
+    CV_Assert(writing_);
+    writing_->timestampMs = timestampMs;
+    writing_->seq.store(++next_, memory_order_relaxed);
+    writing_->state.store(SHM_READY, memory_order_release);
+    mapping_.header()->written.store(next_, memory_order_release);
+    writing_ = nullptr;
+}
+
+bool ShmFrameWriter::write(const Mat& frame, int64_t timestampMs) {
+    Mat slot = beginWrite();
+    if (slot.empty()) return false;
+    CV_Assert(frame.size() == slot.size() && frame.type() == slot.type());
+    frame.copyTo(slot);
+    commit(timestampMs);
+    return true;
+}
+
+void ShmFrameWriter::close() {
+    if (!mapping_.header()) return;
+    mapping_.header()->closed.store(1, memory_order_release);
+    mapping_.unmap();
+}
+
+// Frees a ring slot once the last cv::Mat on it is released
+class SharedMemoryCapture::SlotAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int, const int*, int, void*, size_t*, AccessFlag, UMatUsageFlags) const override {
+        return nullptr;
+    }
+    bool allocate(UMatData*, AccessFlag, UMatUsageFlags) const override { return false; }
+    void deallocate(UMatData* u) const override {
+        ((ShmSlot*)u->userdata)->state.store(SHM_FREE, memory_order_release);
+        delete u;
+    }
+};
+
+SharedMemoryCapture::SharedMemoryCapture() : allocator_(make_unique<SlotAllocator>()) {}
+
+SharedMemoryCapture::~SharedMemoryCapture() = default;
+
+bool SharedMemoryCapture::openRing(const string& name, int timeoutMs) {
+    timeoutMs_ = timeoutMs;
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    // The producer may still be starting up
+    while (!mapping_.map(name, 0) || mapping_.header()->magic.load(memory_order_acquire) != SHM_RING_MAGIC) {
+        mapping_.unmap();
+        if (chrono::steady_clock::now() > deadline) {
+            cerr << "No frame ring at " << name << endl;
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    const ShmRingHeader* header = mapping_.header();
+    // Frames must be 8-bit BGR, as the rest of the pipeline assumes, with rows that fit their step
+    if (header->slots == 0 || header->type != CV_8UC3 || header->width <= 0 || header->height <= 0 ||
+        header->step < (uint64_t)header->width * CV_ELEM_SIZE(CV_8UC3) ||
+        (uint64_t)header->step * header->height > header->slotBytes ||
+        mapping_.size() < shmRingSize(header->slots, header->slotBytes)) {
+        cerr << "Malformed frame ring at " << name << endl;
+        mapping_.unmap();
+        return false;
+    }
+    // Start from the oldest frame still in the ring
+    uint64_t written = header->written.load(memory_order_acquire);
+    next_ = written > header->slots ? written - header->slots : 0;
+    opened_ = true;
+    return true;
+}
+
+bool SharedMemoryCapture::take(uint64_t& index) {
+    ShmRingHeader* header = mapping_.header();
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs_);
+    int idle = 0;
+    for (;;) {
+        uint64_t written = header->written.load(memory_order_acquire);
+        // Frames older than a full lap have been overwritten
+        if (written > next_ + header->slots) next_ = written - header->slots;
+        if (next_ < written) {
+            ShmSlot* slot = mapping_.slot(next_ % header->slots);
+            uint32_t state = SHM_READY;
+            if (slot->state.compare_exchange_strong(state, SHM_READING, memory_order_acq_rel)) {
+                uint64_t seq = slot->seq.load(memory_order_relaxed);
+                if (seq > next_) {
+                    // Possibly a newer lap than asked for; continue after whatever it holds
+                    next_ = seq;
+                    index = (seq - 1) % header->slots;
+                    return true;
+                }
+                slot->state.store(SHM_READY, memory_order_release);
+                next_++;
+            } else if (state == SHM_WRITING) {
+                // Being refilled with a newer frame
+                this_thread::yield();
+            } else {
+                next_++;
+            }
+            continue;
+        }
+        if (header->closed.load(memory_order_acquire)) return false;
+        if (chrono::steady_clock::now() > deadline) {
+            cerr << "Frame ring: no frame for " << timeoutMs_ << " ms" << endl;
+            return false;
+        }
+        if (++idle < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(200));
+    }
+}
+
+bool SharedMemoryCapture::grab() {
+    uint64_t index;
+    if (!opened_ || !take(index)) return false;
+    mapping_.slot(index)->state.store(SHM_FREE, memory_order_release);
+    return true;
+}
+
+bool SharedMemoryCapture::read(OutputArray image) {
+    uint64_t index;
+    if (!opened_ || !take(index)) {
+        image.release();
+        return false;
+    }
+    const ShmRingHeader* header = mapping_.header();
+    Mat frame(header->height, header->width, header->type, mapping_.pixels(index), header->step);
+
+    // Reference-counted like any Mat; the slot is freed with the last copy
+    UMatData* u = new UMatData(allocator_.get());
+    u->data = u->origdata = frame.data;
+    u->size = (size_t)header->step * header->height;
+    u->flags |= UMatData::USER_ALLOCATED;
+    u->userdata = mapping_.slot(index);
+    u->refcount = 1;
+    frame.u = u;
+    frame.allocator = allocator_.get();
+
+    image.assign(frame);
+    return true;
+}
+
+double SharedMemoryCapture::get(int propId) const {
+    if (!mapping_.header()) return 0;
+    if (propId == CAP_PROP_FRAME_WIDTH) return mapping_.header()->width;
+    if (propId == CAP_PROP_FRAME_HEIGHT) return mapping_.header()->height;
+    return 0;
+}
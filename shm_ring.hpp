@@ -0,0 +1,125 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Shared-memory frame ring, one producer process and one consumer:
+//
+//   ShmRingHeader | ShmSlot[slots] | padding to 4 KiB | slots * slotBytes of pixels
+//
+// A slot goes FREE/READY -> WRITING -> READY under the producer and
+// READY -> READING -> FREE under the consumer, each step a compare-and-swap on
+// its state, so neither side touches pixels the other is using. A producer
+// that finds its next slot still being read drops the frame.
+const uint32_t SHM_RING_MAGIC = 0x31524447;  // "GDR1"
+
+enum ShmSlotState : uint32_t { SHM_FREE = 0, SHM_WRITING = 1, SHM_READY = 2, SHM_READING = 3 };
+
+struct ShmSlot {
+    std::atomic<uint32_t> state;
+    uint32_t reserved;
+    // Frame number + 1 of the pixels in the slot
+    std::atomic<uint64_t> seq;
+    int64_t timestampMs;
+};
+
+struct ShmRingHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t slots;
+    // Geometry of every frame: cv::Mat type and row stride in bytes
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    uint32_t step;
+    uint64_t slotBytes;
+    // Frames published so far
+    std::atomic<uint64_t> written;
+    // Set by the producer when the stream has ended
+    std::atomic<uint32_t> closed;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "the frame ring needs address-free atomics");
+
+// A mapped ring: a POSIX shared-memory object ("/name") or any other path as a memory-mapped file
+class ShmMapping {
+public:
+    ShmMapping() = default;
+    ~ShmMapping() { unmap(); }
+    ShmMapping(const ShmMapping&) = delete;
+    ShmMapping& operator=(const ShmMapping&) = delete;
+
+    // size 0 maps an existing ring whole; otherwise creates (or truncates) one of size bytes
+    bool map(const std::string& name, size_t size);
+    void unmap();
+
+    ShmRingHeader* header() const { return (ShmRingHeader*)data_; }
+    ShmSlot* slot(uint64_t i) const;
+    uchar* pixels(uint64_t i) const;
+    size_t size() const { return size_; }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Bytes a ring of this geometry needs
+size_t shmRingSize(uint32_t slots, uint64_t slotBytes);
+
+// Producer side, for the process that decodes the frames
+class ShmFrameWriter {
+public:
+    // type must be CV_8UC3: consumers take BGR frames only
+    bool create(const std::string& name, cv::Size size, int type = CV_8UC3, uint32_t slots = 8);
+    // Slot to decode the next frame into, or an empty Mat when all of them are being read
+    cv::Mat beginWrite();
+    // Publish the frame written into the slot from beginWrite()
+    void commit(int64_t timestampMs);
+    // Copy frame in; false when it was dropped
+    bool write(const cv::Mat& frame, int64_t timestampMs);
+    // Tell the consumer the stream has ended
+    void close();
+
+private:
+    ShmMapping mapping_;
+    uint64_t next_ = 0;
+    ShmSlot* writing_ = nullptr;
+};
+
+// Consumer side: a VideoCapture whose frames are cv::Mat headers on the ring
+// slots themselves, handed back to the producer once the last copy of the
+// header is released. Open with a "shm:" source spec.
+class SharedMemoryCapture : public cv::VideoCapture {
+public:
+    SharedMemoryCapture();
+    ~SharedMemoryCapture() override;
+
+    // name as for ShmMapping::map; waits up to timeoutMs for the producer to create it
+    bool openRing(const std::string& name, int timeoutMs = 5000);
+
+    bool isOpened() const override { return opened_; }
+    void release() override { opened_ = false; }
+    // Skip the next frame
+    bool grab() override;
+    // Next frame without copying when image is a cv::Mat; false once the producer
+    // closed the ring or sent nothing for timeoutMs
+    bool read(cv::OutputArray image) override;
+    // Frame geometry; everything else 0
+    double get(int propId) const override;
+
+private:
+    class SlotAllocator;
+
+    // Claim the next readable slot; false on end of stream
+    bool take(uint64_t& index);
+
+    ShmMapping mapping_;
+    std::unique_ptr<SlotAllocator> allocator_;
+    bool opened_ = false;
+    int timeoutMs_ = 5000;
+    uint64_t next_ = 0;
+};
@@ -0,0 +1,63 @@
+#include "smoothing.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+SmoothingMethod smoothingMethod(const string& name) {
+    if (name == "ema") return SmoothingMethod::Ema;
+    if (name == "vote") return SmoothingMethod::Vote;
+    if (name != "none") cerr << "Unknown smoothing '" << name << "', using none" << endl;
+    return SmoothingMethod::None;
+}
+
+static int argmax(const vector<float>& v) {
+    return (int)(max_element(v.begin(), v.end()) - v.begin());
+}
+
+GenderResult LabelSmoother::add(const GenderResult& raw, const vector<string>& labels,
+                                const SmoothingOptions& options, bool& changed) {
+    changed = false;
+    // Unknown results (no classification available) carry no evidence
+    if (raw.label.empty()) return raw;
+    if (options.method == SmoothingMethod::None || raw.probs.empty()) {
+        changed = raw.label != stable_;
+        stable_ = raw.label;
+        return raw;
+    }
+
+    const size_t n = raw.probs.size();
+    if (scores_.size() != n) {
+        scores_.assign(n, 0.f);
+        votes_.clear();
+        samples_ = 0;
+        label_ = -1;
+    }
+    if (options.method == SmoothingMethod::Ema) {
+        float alpha = samples_ == 0 ? 1.f : options.alpha;
+        for (size_t c = 0; c < n; c++) scores_[c] = alpha * raw.probs[c] + (1 - alpha) * scores_[c];
+    } else {
+        // Shares of the full window, so a label needs several votes before it can win
+        const int window = max(1, options.window);
+        votes_.push_back(argmax(raw.probs));
+        while ((int)votes_.size() > window) votes_.pop_front();
+        fill(scores_.begin(), scores_.end(), 0.f);
+        for (int v : votes_) scores_[v] += 1.f / window;
+    }
+    samples_++;
+
+    int top = argmax(scores_);
+    if (top != label_ && scores_[top] >= options.switchAt) label_ = top;
+    // Until a label is clearly ahead, report the leader without an event
+    int reported = label_ >= 0 ? label_ : top;
+    GenderResult result;
+    result.label = reported < (int)labels.size() ? labels[reported] : "class " + to_string(reported);
+    result.confidence = scores_[reported];
+    result.probs = scores_;
+    if (label_ >= 0 && result.label != stable_) {
+        stable_ = result.label;
+        changed = true;
+    }
+    return result;
+}
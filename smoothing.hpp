@@ -0,0 +1,48 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "gender.hpp"
+
+enum class SmoothingMethod {
+    None,  // every classification replaces the last
+    Ema,   // exponential moving average of the probabilities
+    Vote   // share of the last window classifications won by each label
+};
+
+// Method named by --smoothing
+SmoothingMethod smoothingMethod(const std::string& name);
+
+struct SmoothingOptions {
+    SmoothingMethod method = SmoothingMethod::None;
+    // EMA weight of the newest classification
+    float alpha = 0.3f;
+    // Classifications a vote is taken over
+    int window = 5;
+    // Smoothed score a label needs before it is reported, and to take over from
+    // the current one; between the two labels are held (hysteresis)
+    float switchAt = 0.7f;
+};
+
+// Temporal filter over one track's classifications. The label it reports only
+// changes once another label is clearly ahead, so scores hovering around 0.5
+// do not flip it back and forth.
+class LabelSmoother {
+public:
+    // Fold in a classification and return what the track reports now; changed is
+    // set when the reported label differs from the one before
+    GenderResult add(const GenderResult& raw, const std::vector<std::string>& labels,
+                     const SmoothingOptions& options, bool& changed);
+    // Label of the last change, empty before the first
+    const std::string& stableLabel() const { return stable_; }
+
+private:
+    std::vector<float> scores_;
+    std::deque<int> votes_;
+    int samples_ = 0;
+    // Index of the reported label, -1 until one is clearly ahead
+    int label_ = -1;
+    std::string stable_;
+};
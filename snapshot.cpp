@@ -0,0 +1,102 @@
+#include "snapshot.hpp"
+#include "metrics.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// imwrite parameters for the format's quality knob
+static bool encoderParams(const string& format, int quality, vector<int>& params) {
+    params.clear();
+    int flag;
+    if (format == "jpg" || format == "jpeg")
+        flag = IMWRITE_JPEG_QUALITY;
+    else if (format == "png")
+        flag = IMWRITE_PNG_COMPRESSION;
+    else if (format == "webp")
+        flag = IMWRITE_WEBP_QUALITY;
+    else {
+        cerr << "Unknown snapshot format '" << format << "'" << endl;
+        return false;
+    }
+    if (quality >= 0) params = {flag, quality};
+    return true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    stop();
+}
+
+bool SnapshotWriter::start(const SnapshotOptions& options) {
+    stop();
+    options_ = options;
+    if (!encoderParams(options_.format, options_.quality, params_)) return false;
+    error_code error;
+    filesystem::create_directories(options_.dir, error);
+    if (error) {
+        cerr << "Cannot create snapshot directory " << options_.dir << ": " << error.message() << endl;
+        return false;
+    }
+    queue_ = make_unique<BoundedQueue<Job>>(options_.queueDepth, BackpressurePolicy::DropOldest);
+    for (int i = 0; i < max(1, options_.workers); i++) threads_.emplace_back(&SnapshotWriter::run, this);
+    return true;
+}
+
+string SnapshotWriter::saveFrame(const Mat& frame, const string& stem) {
+    if (!queue_ || frame.empty()) return "";
+    string path = (filesystem::path(options_.dir) / stem).string() + "." + options_.format;
+    queue_->push(Job{frame, path});
+    raiseHighWater(metrics().snapshotQueueHigh, queue_->size());
+    return path;
+}
+
+size_t SnapshotWriter::saveFaces(const Mat& frame, const vector<Rect>& faces, const string& stem) {
+    if (!queue_ || frame.empty()) return 0;
+    string base = (filesystem::path(options_.dir) / stem).string();
+    const Rect bounds(0, 0, frame.cols, frame.rows);
+    size_t queued = 0;
+    for (size_t i = 0; i < faces.size(); i++) {
+        Rect face = faces[i] & bounds;
+        if (face.area() <= 0) continue;
+        // Crops are small; copying lets the caller draw on the frame right away
+        queue_->push(Job{frame(face).clone(), base + "_face" + to_string(i) + "." + options_.format});
+        raiseHighWater(metrics().snapshotQueueHigh, queue_->size());
+        queued++;
+    }
+    return queued;
+}
+
+void SnapshotWriter::stop() {
+    if (threads_.empty()) return;
+    queue_->close();
+    for (auto& t : threads_)
+        if (t.joinable()) t.join();
+    threads_.clear();
+}
+
+void SnapshotWriter::run() {
+    Job job;
+    vector<uchar> encoded;
+    const string ext = "." + options_.format;
+    while (queue_->pop(job)) {
+        bool ok = false;
+        try {
+            ok = imencode(ext, job.image, encoded, params_);
+        } catch (const cv::Exception& e) {
+            cerr << "Cannot encode " << job.path << ": " << e.what() << endl;
+        }
+        if (ok) {
+            ofstream out(job.path, ios::binary);
+            out.write((const char*)encoded.data(), (streamsize)encoded.size());
+            ok = (bool)out;
+            if (!ok) cerr << "Cannot write " << job.path << endl;
+        }
+        if (ok) saved_++;
+        // Let the frame buffer go back to its pool
+        job.image.release();
+    }
+}
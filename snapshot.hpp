@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+struct SnapshotOptions {
+    std::string dir = ".";
+    // jpg, png or webp
+    std::string format = "jpg";
+    // JPEG/WebP quality 1..100 or PNG compression 0..9 (-1 = codec default)
+    int quality = -1;
+    // Encoder threads
+    int workers = 2;
+    // Snapshots waiting for an encoder; the oldest is dropped beyond this
+    size_t queueDepth = 32;
+};
+
+// Encodes and writes snapshots on a pool of threads so saving never stalls the
+// render loop. Each encoder reuses its output buffer between images.
+class SnapshotWriter {
+public:
+    SnapshotWriter() = default;
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    bool start(const SnapshotOptions& options);
+    bool isOpen() const { return !threads_.empty(); }
+
+    // Queue frame as <dir>/<stem>.<format>; it is shared, not copied, so do not
+    // draw on it afterwards. Returns the file name.
+    std::string saveFrame(const cv::Mat& frame, const std::string& stem);
+    // Queue copies of the face crops as <stem>_face<i>; returns how many
+    size_t saveFaces(const cv::Mat& frame, const std::vector<cv::Rect>& faces, const std::string& stem);
+    // Write everything queued so far and stop the encoders
+    void stop();
+
+    size_t saved() const { return saved_; }
+    size_t dropped() const { return queue_ ? queue_->dropped() : 0; }
+
+private:
+    struct Job {
+        cv::Mat image;
+        std::string path;
+    };
+
+    void run();
+
+    SnapshotOptions options_;
+    std::vector<int> params_;
+    std::unique_ptr<BoundedQueue<Job>> queue_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> saved_{0};
+};
@@ -0,0 +1,95 @@
+#include "source.hpp"
+#include "shm_ring.hpp"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+vector<string> splitSources(const string& list) {
+    vector<string> sources;
+    char separator = list.find(';') != string::npos ? ';' : ',';
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(separator, start);
+        if (end == string::npos) end = list.size();
+        string spec = list.substr(start, end - start);
+        spec.erase(0, spec.find_first_not_of(" \t"));
+        spec.erase(spec.find_last_not_of(" \t") + 1);
+        if (!spec.empty()) sources.push_back(spec);
+        start = end + 1;
+    }
+    return sources;
+}
+
+static bool isDeviceIndex(const string& spec) {
+    return !spec.empty() && all_of(spec.begin(), spec.end(), [](unsigned char c) { return isdigit(c); });
+}
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && \
+    (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#define HAVE_VIDEO_ACCELERATION 1
+#endif
+
+static int captureApi(const string& name) {
+    if (name == "ffmpeg") return CAP_FFMPEG;
+    if (name == "gstreamer") return CAP_GSTREAMER;
+    if (name != "any") cerr << "Unknown capture API '" << name << "', using any" << endl;
+    return CAP_ANY;
+}
+
+#ifdef HAVE_VIDEO_ACCELERATION
+static int videoAcceleration(const string& name) {
+    if (name == "any") return VIDEO_ACCELERATION_ANY;
+    if (name == "vaapi") return VIDEO_ACCELERATION_VAAPI;
+    if (name == "d3d11") return VIDEO_ACCELERATION_D3D11;
+    if (name == "mfx") return VIDEO_ACCELERATION_MFX;
+    if (name != "none") cerr << "Unknown hardware decoder '" << name << "', using none" << endl;
+    return VIDEO_ACCELERATION_NONE;
+}
+#endif
+
+static const string SHM_PREFIX = "shm:";
+
+unique_ptr<VideoCapture> openVideoSource(const string& spec, const CaptureOptions& options) {
+    if (spec.compare(0, SHM_PREFIX.size(), SHM_PREFIX) == 0) {
+        auto ring = make_unique<SharedMemoryCapture>();
+        if (!ring->openRing(spec.substr(SHM_PREFIX.size()))) return nullptr;
+        cout << sourceName(spec) << ": shared-memory ring, " << ring->get(CAP_PROP_FRAME_WIDTH) << "x"
+             << ring->get(CAP_PROP_FRAME_HEIGHT) << endl;
+        return ring;
+    }
+
+    int api = captureApi(options.api);
+    auto cap = make_unique<VideoCapture>();
+    // Open parameters, like the acceleration constants, arrived in OpenCV 4.5.2
+#ifdef HAVE_VIDEO_ACCELERATION
+    vector<int> params;
+    int accel = videoAcceleration(options.hwDecode);
+    if (accel != VIDEO_ACCELERATION_NONE) params = {CAP_PROP_HW_ACCELERATION, accel};
+    bool ok = isDeviceIndex(spec) ? cap->open(stoi(spec), api, params) : cap->open(spec, api, params);
+#else
+    if (options.hwDecode != "none") cerr << "Hardware decoding needs OpenCV 4.5.2 or newer" << endl;
+    bool ok = isDeviceIndex(spec) ? cap->open(stoi(spec), api) : cap->open(spec, api);
+#endif
+    if (!ok || !cap->isOpened()) {
+        cerr << "Cannot open video source " << spec << endl;
+        return nullptr;
+    }
+    if (options.bufferSize > 0) cap->set(CAP_PROP_BUFFERSIZE, options.bufferSize);
+
+    cout << sourceName(spec) << ": " << cap->getBackendName();
+#ifdef HAVE_VIDEO_ACCELERATION
+    int used = (int)cap->get(CAP_PROP_HW_ACCELERATION);
+    cout << (used != VIDEO_ACCELERATION_NONE ? ", hardware decoding" : ", software decoding");
+#endif
+    cout << endl;
+    return cap;
+}
+
+string sourceName(const string& spec) {
+    return isDeviceIndex(spec) ? "camera" + spec : spec;
+}
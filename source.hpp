@@ -0,0 +1,26 @@
+#pragma once
+
+#include <opencv2/videoio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Split a --sources list on ';' if it has one (GStreamer caps contain commas), else on ','.
+std::vector<std::string> splitSources(const std::string& list);
+
+struct CaptureOptions {
+    // Hardware decoding: none, any, vaapi, d3d11 or mfx
+    std::string hwDecode = "none";
+    // Capture API: any, ffmpeg or gstreamer (spec is then a GStreamer pipeline)
+    std::string api = "any";
+    // Frames the backend may buffer (0 = its default); 1 keeps live latency low
+    int bufferSize = 0;
+};
+
+// Open a capture source: a device index ("0"), a video file, an RTSP/HTTP URL, or
+// "shm:<name>" for the shared-memory frame ring of another process. nullptr on failure.
+std::unique_ptr<cv::VideoCapture> openVideoSource(const std::string& spec,
+                                                  const CaptureOptions& options = CaptureOptions());
+
+// Name used for a source in results and window titles
+std::string sourceName(const std::string& spec);
@@ -0,0 +1,179 @@
+#include "tracker.hpp"
+#include "detector.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video.hpp>
+#include <algorithm>
+#include <utility>
+
+using namespace cv;
+using namespace std;
+
+float iou(const Rect& a, const Rect& b) {
+    int inter = (a & b).area();
+    int uni = a.area() + b.area() - inter;
+    return uni > 0 ? (float)inter / uni : 0.f;
+}
+
+void FaceTracker::update(const vector<Rect>& faces, vector<int>& faceTracks) {
+    // Forget tracks that have not been seen for too long
+    tracks_.erase(remove_if(tracks_.begin(), tracks_.end(),
+                            [&](const Track& t) { return t.missed > options_.maxMissed; }),
+                  tracks_.end());
+
+    for (auto& track : tracks_) {
+        track.missed++;
+        track.framesSinceClassified++;
+        track.gender.confidence *= options_.confidenceDecay;
+    }
+
+    // Greedy association, best overlapping pairs first
+    struct Match {
+        float iou;
+        int face;
+        int track;
+    };
+    vector<Match> matches;
+    for (int f = 0; f < (int)faces.size(); f++)
+        for (int t = 0; t < (int)tracks_.size(); t++) {
+            float overlap = iou(faces[f], tracks_[t].box);
+            if (overlap >= options_.iouThreshold) matches.push_back({overlap, f, t});
+        }
+    sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.iou > b.iou; });
+
+    faceTracks.assign(faces.size(), -1);
+    vector<bool> trackTaken(tracks_.size(), false);
+    for (const Match& m : matches) {
+        if (faceTracks[m.face] >= 0 || trackTaken[m.track]) continue;
+        faceTracks[m.face] = m.track;
+        trackTaken[m.track] = true;
+        tracks_[m.track].box = faces[m.face];
+        tracks_[m.track].missed = 0;
+    }
+
+    // Unmatched detections start new tracks
+    for (int f = 0; f < (int)faces.size(); f++) {
+        if (faceTracks[f] >= 0) continue;
+        Track track;
+        track.id = nextId_++;
+        track.box = faces[f];
+        faceTracks[f] = (int)tracks_.size();
+        tracks_.push_back(track);
+    }
+}
+
+bool FaceTracker::needsClassification(int trackIndex) const {
+    const Track& track = tracks_[trackIndex];
+    if (track.pending) return false;
+    return !track.classified || track.framesSinceClassified >= options_.reclassifyEvery ||
+           track.gender.confidence < options_.minConfidence;
+}
+
+bool FaceTracker::setGender(int trackId, const GenderResult& gender, LabelEvent& event) {
+    for (Track& track : tracks_) {
+        if (track.id != trackId) continue;
+        string previous = track.smoother.stableLabel();
+        bool changed;
+        track.gender = track.smoother.add(gender, labels_, options_.smoothing, changed);
+        track.classified = true;
+        track.pending = false;
+        track.framesSinceClassified = 0;
+        if (changed) event = {trackId, previous, track.gender.label, track.gender.confidence};
+        return changed;
+    }
+    return false;
+}
+
+const Track* FaceTracker::find(int trackId) const {
+    for (const Track& track : tracks_)
+        if (track.id == trackId) return &track;
+    return nullptr;
+}
+
+bool FacePropagator::beginFrame(const Mat& frame) {
+    if (options_.detectEvery <= 1) return true;
+
+    swap(prevGray_, gray_);
+    frameSize_ = frame.size();
+    Mat working = toWorkingResolution(frame, options_.flowWidth, small_, scale_);
+    cvtColor(working, gray_, COLOR_BGR2GRAY);
+
+    if (keyGray_.empty() || keyGray_.size() != gray_.size()) return true;
+    if (sinceDetection_ + 1 >= options_.detectEvery) return true;
+
+    // Large changes since the last detection mean the boxes can no longer be trusted
+    absdiff(gray_, keyGray_, diff_);
+    return mean(diff_)[0] > options_.sceneChange;
+}
+
+void FacePropagator::detected(const vector<Rect>& faces) {
+    if (options_.detectEvery <= 1) return;
+
+    boxes_.clear();
+    for (const Rect& face : faces)
+        boxes_.emplace_back(cvRound(face.x / scale_), cvRound(face.y / scale_),
+                            cvRound(face.width / scale_), cvRound(face.height / scale_));
+    gray_.copyTo(keyGray_);
+    sinceDetection_ = 0;
+}
+
+void FacePropagator::setDetectEvery(int n) {
+    n = max(1, n);
+    bool stale = options_.detectEvery <= 1 && n > 1;
+    options_.detectEvery = n;
+    if (!stale) return;
+    keyGray_.release();
+    boxes_.clear();
+    sinceDetection_ = 0;
+}
+
+void FacePropagator::propagate(vector<Rect>& faces) {
+    sinceDetection_++;
+    faces.clear();
+    if (boxes_.empty() || prevGray_.size() != gray_.size()) return;
+
+    // Corners inside each box on the previous frame
+    points_.clear();
+    owner_.clear();
+    for (int b = 0; b < (int)boxes_.size(); b++) {
+        Rect box = boxes_[b] & Rect(0, 0, prevGray_.cols, prevGray_.rows);
+        if (box.width < 8 || box.height < 8) continue;
+        goodFeaturesToTrack(prevGray_(box), corners_, options_.pointsPerFace, 0.01, 3);
+        for (const Point2f& c : corners_) {
+            points_.push_back(Point2f(c.x + box.x, c.y + box.y));
+            owner_.push_back(b);
+        }
+    }
+    if (points_.empty()) {
+        boxes_.clear();
+        return;
+    }
+
+    calcOpticalFlowPyrLK(prevGray_, gray_, points_, next_, status_, err_);
+
+    // Shift each box by the median motion of its corners
+    vector<Rect> moved;
+    for (int b = 0; b < (int)boxes_.size(); b++) {
+        dx_.clear();
+        dy_.clear();
+        for (size_t i = 0; i < points_.size(); i++) {
+            if (owner_[i] != b || !status_[i]) continue;
+            dx_.push_back(next_[i].x - points_[i].x);
+            dy_.push_back(next_[i].y - points_[i].y);
+        }
+        if (dx_.size() < 3) continue;
+        nth_element(dx_.begin(), dx_.begin() + dx_.size() / 2, dx_.end());
+        nth_element(dy_.begin(), dy_.begin() + dy_.size() / 2, dy_.end());
+        Rect box = boxes_[b];
+        box.x += cvRound(dx_[dx_.size() / 2]);
+        box.y += cvRound(dy_[dy_.size() / 2]);
+        box &= Rect(0, 0, gray_.cols, gray_.rows);
+        if (!box.empty()) moved.push_back(box);
+    }
+    boxes_ = moved;
+
+    faces = boxes_;
+    remapToFrame(faces, scale_, frameSize_);
+    faces.erase(remove_if(faces.begin(), faces.end(), [](const Rect& r) { return r.empty(); }),
+                faces.end());
+}
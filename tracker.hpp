@@ -0,0 +1,121 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "gender.hpp"
+#include "smoothing.hpp"
+
+struct TrackerOptions {
+    // Minimum IoU between a detection and a track's last box to associate them
+    float iouThreshold = 0.3f;
+    // Frames a track survives without a matching detection
+    int maxMissed = 10;
+    // Re-classify a track at least this often ...
+    int reclassifyEvery = 30;
+    // ... or once its cached confidence has decayed below this. Softmax confidence
+    // is at least 1 / classes, so keep it just above: a face classified at 0.9
+    // then lasts about 28 frames, one at 0.55 about 4, one below it just 1.
+    float minConfidence = 0.51f;
+    // Per-frame multiplier applied to the cached confidence
+    float confidenceDecay = 0.98f;
+    // How each track combines its classifications over time
+    SmoothingOptions smoothing;
+};
+
+// One tracked face with its cached gender
+struct Track {
+    int id = 0;
+    cv::Rect box;
+    GenderResult gender;
+    bool classified = false;
+    // Sent to the gender net, result not back yet
+    bool pending = false;
+    int framesSinceClassified = 0;
+    int missed = 0;
+    LabelSmoother smoother;
+};
+
+// IoU-based multi-face tracker that keeps the gender of each person between
+// classifications, so the gender net only runs on new or stale tracks
+class FaceTracker {
+public:
+    // labels name the gender net's classes, for smoothed results
+    explicit FaceTracker(const TrackerOptions& options = TrackerOptions(),
+                         const std::vector<std::string>& labels = GenderModel().labels)
+        : options_(options), labels_(labels) {}
+
+    // Associate this frame's detections with tracks. faceTracks[i] is the index
+    // into tracks() of faces[i]; indices stay valid until the next update().
+    void update(const std::vector<cv::Rect>& faces, std::vector<int>& faceTracks);
+
+    // Whether the track's cached gender is missing or too old to trust
+    bool needsClassification(int trackIndex) const;
+    void markPending(int trackIndex) { tracks_[trackIndex].pending = true; }
+    // Fold a classification into the track's gender; ignored if the track has
+    // been dropped meanwhile. Fills event and returns true when the reported label changed.
+    bool setGender(int trackId, const GenderResult& gender, LabelEvent& event);
+
+    // Track by id, nullptr once it has been dropped
+    const Track* find(int trackId) const;
+
+    const std::vector<Track>& tracks() const { return tracks_; }
+
+private:
+    TrackerOptions options_;
+    std::vector<std::string> labels_;
+    std::vector<Track> tracks_;
+    int nextId_ = 1;
+};
+
+struct PropagatorOptions {
+    // Run the face detector every N frames (1 = every frame, no propagation)
+    int detectEvery = 1;
+    // Mean absolute gray difference to the last detected frame that forces a detection
+    double sceneChange = 20.0;
+    // Width of the grayscale frames optical flow runs on
+    int flowWidth = 480;
+    // Corners tracked per face box
+    int pointsPerFace = 20;
+};
+
+// Moves face boxes between detections with sparse Lucas-Kanade optical flow
+class FacePropagator {
+public:
+    explicit FacePropagator(const PropagatorOptions& options = PropagatorOptions()) : options_(options) {}
+
+    // Take the next frame; true when the face detector should run on it
+    bool beginFrame(const cv::Mat& frame);
+    // Boxes the detector found on the current frame
+    void detected(const std::vector<cv::Rect>& faces);
+    // Boxes of the previous frame moved onto the current one; lost faces are dropped
+    void propagate(std::vector<cv::Rect>& faces);
+
+    // Change the detection cadence from the next frame on. Grays and boxes are
+    // not kept up at a cadence of 1, so leaving it forgets them and detects afresh.
+    void setDetectEvery(int n);
+
+private:
+    PropagatorOptions options_;
+    cv::Mat small_;
+    cv::Mat gray_;
+    cv::Mat prevGray_;
+    cv::Mat keyGray_;
+    cv::Mat diff_;
+    double scale_ = 1.0;
+    cv::Size frameSize_;
+    int sinceDetection_ = 0;
+    std::vector<cv::Rect> boxes_;
+    std::vector<cv::Point2f> corners_;
+    std::vector<cv::Point2f> points_;
+    std::vector<cv::Point2f> next_;
+    std::vector<int> owner_;
+    std::vector<uchar> status_;
+    std::vector<float> err_;
+    std::vector<float> dx_;
+    std::vector<float> dy_;
+};
+
+// Intersection over union of two boxes
+float iou(const cv::Rect& a, const cv::Rect& b);
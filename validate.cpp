@@ -0,0 +1,91 @@
+#include "validate.hpp"
+#include "batch.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+using namespace dnn;
+namespace fs = std::filesystem;
+
+// Disagreeing faces listed in the report
+const size_t MAX_LISTED = 10;
+
+int runValidation(const ValidateOptions& options) {
+    if (!fs::is_directory(options.sampleDir)) {
+        cerr << "Not a directory: " << options.sampleDir << endl;
+        return -1;
+    }
+    unique_ptr<FaceDetector> detector = createFaceDetector(options.detector, options.detectorOptions);
+    if (!detector) return -1;
+    Net reference = loadGenderNet(options.referenceBackend, options.reference);
+    Net candidate = loadGenderNet(options.backend, options.candidate);
+
+    // One face per forward pass so both models are timed on the same work
+    GenderBlob referenceBlob(1, options.reference);
+    GenderBlob candidateBlob(1, options.candidate);
+    vector<Rect> faces;
+    vector<GenderResult> expected, actual;
+    TickMeter referenceTime, candidateTime;
+    size_t images = 0, total = 0, agreed = 0;
+    double driftSum = 0, driftMax = 0;
+    vector<string> disagreements;
+
+    error_code ec;
+    for (auto it = fs::recursive_directory_iterator(options.sampleDir, ec);
+         it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_regular_file(ec) || !isImageFile(it->path().string())) continue;
+        Mat image = imread(it->path().string(), IMREAD_COLOR);
+        if (image.empty()) continue;
+        images++;
+
+        detector->detect(image, faces);
+        if (faces.empty()) faces.push_back(Rect(0, 0, image.cols, image.rows));
+
+        referenceTime.start();
+        classifyGenderBatch(reference, image, faces, referenceBlob, expected);
+        referenceTime.stop();
+        candidateTime.start();
+        classifyGenderBatch(candidate, image, faces, candidateBlob, actual);
+        candidateTime.stop();
+
+        for (size_t i = 0; i < faces.size(); i++) {
+            total++;
+            if (actual[i].label == expected[i].label) {
+                agreed++;
+                double drift = fabs(actual[i].confidence - expected[i].confidence);
+                driftSum += drift;
+                driftMax = max(driftMax, drift);
+            } else if (disagreements.size() < MAX_LISTED) {
+                disagreements.push_back(it->path().string() + " face " + to_string(i) + ": " +
+                                        expected[i].label + " -> " + actual[i].label);
+            }
+        }
+    }
+    if (total == 0) {
+        cerr << "No sample faces under " << options.sampleDir << endl;
+        return -1;
+    }
+
+    double agreement = (double)agreed / total;
+    cout << "Validated " << options.candidate.model << " against " << options.reference.model << " on "
+         << total << " faces from " << images << " images" << endl;
+    cout << "  label agreement   " << agreement * 100 << "% (" << total - agreed << " differ)" << endl;
+    if (agreed > 0)
+        cout << "  confidence drift  mean " << driftSum / agreed << ", max " << driftMax << endl;
+    cout << "  ms per face       reference " << referenceTime.getTimeMilli() / total << ", candidate "
+         << candidateTime.getTimeMilli() / total << endl;
+    for (const string& line : disagreements) cout << "  " << line << endl;
+
+    if (agreement < options.minAgreement) {
+        cerr << "Agreement below " << options.minAgreement * 100 << "%" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "detector.hpp"
+#include "gender.hpp"
+
+struct ValidateOptions {
+    // Directory walked recursively for sample images
+    std::string sampleDir;
+    // Model under test, and the FP32 model it has to agree with
+    GenderModel candidate;
+    GenderModel reference;
+    std::string backend = "cpu";
+    std::string referenceBackend = "cpu";
+    // Faces come from this detector; images without a detection are taken as one face crop
+    std::string detector = "haar";
+    FaceDetectorOptions detectorOptions;
+    // Fraction of faces that must get the reference label
+    double minAgreement = 0.98;
+};
+
+// Run both models over the same face crops and report label agreement,
+// confidence drift and speed. Returns 0 when agreement reaches minAgreement.
+int runValidation(const ValidateOptions& options);